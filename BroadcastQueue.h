@@ -0,0 +1,291 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Single-writer, multi-reader broadcast ring (Disruptor style).
+//
+// Every reader sees every element through its own sequence cursor, so one
+// Push fans out to all readers without copies. The writer is gated by the
+// slowest reader and never overwrites a slot that is still unread. A reader
+// may depend on other readers (pipeline stages): it only sees sequences that
+// all of its dependencies have already consumed.
+//
+// Readers must be added before the writer starts pushing. Push must only be
+// called from one thread, each Reader must only be used from one thread.
+// Blocking waits spin for a short while, then sleep on a condition variable
+// that every cursor or sequence update signals when someone is sleeping.
+// Allocator places the ring storage, see NumaAllocator.h.
+template <typename DataType, typename Allocator = std::allocator<DataType>>
+class BroadcastQueue {
+public:
+  class Reader {
+  public:
+    // msecs == 0: return immediately, msecs < 0: wait forever,
+    // msecs > 0: wait at most msecs milliseconds.
+    bool Pop(DataType& data, long msecs = 0)
+    {
+      int64_t next = sequence_.load(std::memory_order_relaxed) + 1;
+      if (WaitFor(next, msecs) < next) {
+        return false;
+      }
+      data = queue_->ring_[next & queue_->mask_];
+      sequence_.store(next, std::memory_order_release);
+      queue_->Signal();
+      return true;
+    }
+
+    // Appends everything up to the published cursor (at most maxCount items
+    // if maxCount > 0) and returns the number of items read.
+    int PopAll(std::vector<DataType>& data_arr, int maxCount = 0)
+    {
+      int64_t seq = sequence_.load(std::memory_order_relaxed);
+      int64_t end = BatchEnd(seq, maxCount);
+      for (int64_t i = seq + 1; i <= end; i++) {
+        data_arr.emplace_back(queue_->ring_[i & queue_->mask_]);
+      }
+      sequence_.store(end, std::memory_order_release);
+      queue_->Signal();
+      return static_cast<int>(end - seq);
+    }
+
+    // Visits everything up to the published cursor in place. The handler is
+    // called as handler(const DataType& data, int64_t sequence, bool end_of_batch)
+    // and the slots are released to the writer once the whole batch is done.
+    template <typename Handler>
+    int Consume(Handler&& handler, int maxCount = 0)
+    {
+      int64_t seq = sequence_.load(std::memory_order_relaxed);
+      int64_t end = BatchEnd(seq, maxCount);
+      for (int64_t i = seq + 1; i <= end; i++) {
+        handler(static_cast<const DataType&>(queue_->ring_[i & queue_->mask_]), i, i == end);
+      }
+      sequence_.store(end, std::memory_order_release);
+      queue_->Signal();
+      return static_cast<int>(end - seq);
+    }
+
+    // Number of items this reader could read right now.
+    int Available() const
+    {
+      int64_t available = Barrier() - sequence_.load(std::memory_order_relaxed);
+      return available > 0 ? static_cast<int>(available) : 0;
+    }
+
+    // Last sequence consumed by this reader, -1 if nothing was consumed yet.
+    int64_t Sequence() const
+    {
+      return sequence_.load(std::memory_order_acquire);
+    }
+
+  private:
+    friend class BroadcastQueue;
+
+    Reader(BroadcastQueue* queue, const std::vector<Reader*>& depends_on, int64_t start)
+      : queue_(queue), depends_on_(depends_on.begin(), depends_on.end()), sequence_(start)
+    {
+    }
+
+    // Highest sequence this reader is allowed to consume.
+    int64_t Barrier() const
+    {
+      int64_t barrier = queue_->cursor_.load(std::memory_order_acquire);
+      for (const Reader* dep : depends_on_) {
+        int64_t seq = dep->sequence_.load(std::memory_order_acquire);
+        if (seq < barrier) {
+          barrier = seq;
+        }
+      }
+      return barrier;
+    }
+
+    // Never below seq: a reader added later than its dependencies may be
+    // ahead of them until they catch up.
+    int64_t BatchEnd(int64_t seq, int maxCount) const
+    {
+      int64_t end = Barrier();
+      if (end < seq) {
+        end = seq;
+      }
+      if (maxCount > 0 && end - seq > maxCount) {
+        end = seq + maxCount;
+      }
+      return end;
+    }
+
+    int64_t WaitFor(int64_t seq, long msecs) const
+    {
+      int64_t barrier = Barrier();
+      if (barrier >= seq || msecs == 0) {
+        return barrier;
+      }
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(msecs);
+      queue_->WaitUntil([this, seq] { return Barrier() >= seq; }, msecs < 0, deadline);
+      return Barrier();
+    }
+
+    BroadcastQueue* queue_;
+    std::vector<const Reader*> depends_on_;
+    char pad0_[64];  // keep the cursor on its own cache line
+    std::atomic<int64_t> sequence_;
+    char pad1_[64];
+  };
+
+  // cap is rounded up to the next power of two.
+  explicit BroadcastQueue(int cap, const Allocator& alloc = Allocator())
+    : cap_(RoundUpPowerOfTwo(cap)), mask_(cap_ - 1), ring_(cap_, alloc),
+      cursor_(-1), next_(-1), gating_cache_(-1), waiters_(0)
+  {
+  }
+
+  ~BroadcastQueue() {}
+
+  // Registers a reader that starts after the last published sequence. The
+  // reader only sees sequences already consumed by all of depends_on, so
+  // if they are behind, it waits until they pass its start.
+  Reader* AddReader(const std::vector<Reader*>& depends_on = std::vector<Reader*>())
+  {
+    readers_.emplace_back(new Reader(this, depends_on, cursor_.load(std::memory_order_acquire)));
+    gating_cache_ = MinimumReaderSequence();
+    return readers_.back().get();
+  }
+
+  // Publishes data to every reader. If the slowest reader is a whole ring
+  // behind, returns false, or spins until it catches up when forever is set.
+  bool Push(const DataType& data, bool forever = false)
+  {
+    int64_t seq = next_ + 1;
+    int64_t wrap = seq - cap_;
+    if (wrap > gating_cache_) {
+      gating_cache_ = MinimumReaderSequence();
+      if (wrap > gating_cache_) {
+        if (!forever) {
+          return false;
+        }
+        WaitUntil([this, wrap] {
+          gating_cache_ = MinimumReaderSequence();
+          return wrap <= gating_cache_;
+        }, true, std::chrono::steady_clock::time_point());
+      }
+    }
+
+    ring_[seq & mask_] = data;
+    next_ = seq;
+    cursor_.store(seq, std::memory_order_release);
+    Signal();
+    return true;
+  }
+
+  int Capacity() const
+  {
+    return cap_;
+  }
+
+  // Number of items not yet consumed by the slowest reader.
+  int Size() const
+  {
+    return static_cast<int>(cursor_.load(std::memory_order_acquire) - MinimumReaderSequence());
+  }
+
+  bool IsEmpty() const
+  {
+    return Size() <= 0;
+  }
+
+  bool IsFull() const
+  {
+    return Size() >= cap_;
+  }
+
+  // Last published sequence, -1 if nothing was published yet.
+  int64_t Cursor() const
+  {
+    return cursor_.load(std::memory_order_acquire);
+  }
+
+private:
+  static int RoundUpPowerOfTwo(int cap)
+  {
+    int n = 1;
+    while (n < cap) {
+      n <<= 1;
+    }
+    return n;
+  }
+
+  // Waits until ready() holds, forever or until deadline. Spins first, since
+  // the other side usually catches up quickly, then sleeps until Signal.
+  // Returns ready().
+  template <typename Ready>
+  bool WaitUntil(Ready ready, bool forever, std::chrono::steady_clock::time_point deadline)
+  {
+    for (int i = 0; i < kSpinCount; i++) {
+      if (ready()) {
+        return true;
+      }
+      if (!forever && std::chrono::steady_clock::now() >= deadline) {
+        return false;
+      }
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    waiters_.fetch_add(1);
+    bool ok = true;
+    if (forever) {
+      wait_cv_.wait(lock, ready);
+    } else {
+      ok = wait_cv_.wait_until(lock, deadline, ready);
+    }
+    waiters_.fetch_sub(1);
+    return ok;
+  }
+
+  // Called after every cursor or reader sequence update. The fence orders
+  // the update before reading waiters_, and pairs with the waiter that
+  // registers in waiters_ before checking its condition, so a wakeup is
+  // never lost while nobody sleeping costs no lock.
+  void Signal()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(wait_mutex_);
+      wait_cv_.notify_all();
+    }
+  }
+
+  // Gating sequence: the writer may not pass the slowest reader. Without any
+  // reader nothing is gated and published items are simply overwritten.
+  int64_t MinimumReaderSequence() const
+  {
+    int64_t min_seq = cursor_.load(std::memory_order_acquire);
+    for (const auto& reader : readers_) {
+      int64_t seq = reader->sequence_.load(std::memory_order_acquire);
+      if (seq < min_seq) {
+        min_seq = seq;
+      }
+    }
+    return min_seq;
+  }
+
+private:
+  static const int kSpinCount = 100;
+
+  int cap_;
+  int64_t mask_;
+  std::vector<DataType, Allocator> ring_;
+  std::vector<std::unique_ptr<Reader>> readers_;
+  char pad0_[64];  // keep the cursor away from the writer-only fields
+  std::atomic<int64_t> cursor_;
+  char pad1_[64];
+  int64_t next_;
+  int64_t gating_cache_;
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cv_;
+  std::atomic<int> waiters_;
+};
@@ -0,0 +1,468 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLUMNAR_HAVE_AVX2 1
+#define COLUMNAR_AVX2 __attribute__((target("avx2")))
+#endif
+
+enum class ColumnOp { kLess, kLessEqual, kGreater, kGreaterEqual, kEqual, kNotEqual };
+
+// Compares up to 64 values of a column with value and returns the result as
+// a bitmask, bit i for data[i].
+template <typename T>
+uint64_t ColumnScanScalar(const T* data, int n, ColumnOp op, const T& value)
+{
+  uint64_t bits = 0;
+  for (int i = 0; i < n; i++) {
+    bool match = false;
+    switch (op) {
+      case ColumnOp::kLess: match = data[i] < value; break;
+      case ColumnOp::kLessEqual: match = data[i] <= value; break;
+      case ColumnOp::kGreater: match = data[i] > value; break;
+      case ColumnOp::kGreaterEqual: match = data[i] >= value; break;
+      case ColumnOp::kEqual: match = data[i] == value; break;
+      case ColumnOp::kNotEqual: match = data[i] != value; break;
+    }
+    bits |= static_cast<uint64_t>(match) << i;
+  }
+  return bits;
+}
+
+inline bool ColumnScanHasAvx2()
+{
+#ifdef COLUMNAR_HAVE_AVX2
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+#else
+  return false;
+#endif
+}
+
+// Column types with an AVX2 scan: float, double, int32_t and int64_t.
+template <typename T> struct HasAvx2Scan : std::false_type {};
+
+#ifdef COLUMNAR_HAVE_AVX2
+// One AVX2 register worth of comparisons, returned as a movemask.
+template <typename T> struct Avx2Lanes;
+
+template <> struct Avx2Lanes<float> {
+  static const int kLanes = 8;
+  COLUMNAR_AVX2 static int Compare(const float* p, ColumnOp op, float value)
+  {
+    __m256 x = _mm256_loadu_ps(p);
+    __m256 v = _mm256_set1_ps(value);
+    switch (op) {
+      case ColumnOp::kLess: return _mm256_movemask_ps(_mm256_cmp_ps(x, v, _CMP_LT_OQ));
+      case ColumnOp::kLessEqual: return _mm256_movemask_ps(_mm256_cmp_ps(x, v, _CMP_LE_OQ));
+      case ColumnOp::kGreater: return _mm256_movemask_ps(_mm256_cmp_ps(x, v, _CMP_GT_OQ));
+      case ColumnOp::kGreaterEqual: return _mm256_movemask_ps(_mm256_cmp_ps(x, v, _CMP_GE_OQ));
+      case ColumnOp::kEqual: return _mm256_movemask_ps(_mm256_cmp_ps(x, v, _CMP_EQ_OQ));
+      default: return _mm256_movemask_ps(_mm256_cmp_ps(x, v, _CMP_NEQ_UQ));
+    }
+  }
+};
+
+template <> struct Avx2Lanes<double> {
+  static const int kLanes = 4;
+  COLUMNAR_AVX2 static int Compare(const double* p, ColumnOp op, double value)
+  {
+    __m256d x = _mm256_loadu_pd(p);
+    __m256d v = _mm256_set1_pd(value);
+    switch (op) {
+      case ColumnOp::kLess: return _mm256_movemask_pd(_mm256_cmp_pd(x, v, _CMP_LT_OQ));
+      case ColumnOp::kLessEqual: return _mm256_movemask_pd(_mm256_cmp_pd(x, v, _CMP_LE_OQ));
+      case ColumnOp::kGreater: return _mm256_movemask_pd(_mm256_cmp_pd(x, v, _CMP_GT_OQ));
+      case ColumnOp::kGreaterEqual: return _mm256_movemask_pd(_mm256_cmp_pd(x, v, _CMP_GE_OQ));
+      case ColumnOp::kEqual: return _mm256_movemask_pd(_mm256_cmp_pd(x, v, _CMP_EQ_OQ));
+      default: return _mm256_movemask_pd(_mm256_cmp_pd(x, v, _CMP_NEQ_UQ));
+    }
+  }
+};
+
+// AVX2 only has signed greater-than and equal for integers; the other
+// comparisons are derived from them.
+template <> struct Avx2Lanes<int32_t> {
+  static const int kLanes = 8;
+  COLUMNAR_AVX2 static int Compare(const int32_t* p, ColumnOp op, int32_t value)
+  {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i v = _mm256_set1_epi32(value);
+    switch (op) {
+      case ColumnOp::kLess: return Mask(_mm256_cmpgt_epi32(v, x));
+      case ColumnOp::kLessEqual: return ~Mask(_mm256_cmpgt_epi32(x, v)) & 0xff;
+      case ColumnOp::kGreater: return Mask(_mm256_cmpgt_epi32(x, v));
+      case ColumnOp::kGreaterEqual: return ~Mask(_mm256_cmpgt_epi32(v, x)) & 0xff;
+      case ColumnOp::kEqual: return Mask(_mm256_cmpeq_epi32(x, v));
+      default: return ~Mask(_mm256_cmpeq_epi32(x, v)) & 0xff;
+    }
+  }
+
+  COLUMNAR_AVX2 static int Mask(__m256i m)
+  {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(m));
+  }
+};
+
+template <> struct Avx2Lanes<int64_t> {
+  static const int kLanes = 4;
+  COLUMNAR_AVX2 static int Compare(const int64_t* p, ColumnOp op, int64_t value)
+  {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i v = _mm256_set1_epi64x(value);
+    switch (op) {
+      case ColumnOp::kLess: return Mask(_mm256_cmpgt_epi64(v, x));
+      case ColumnOp::kLessEqual: return ~Mask(_mm256_cmpgt_epi64(x, v)) & 0xf;
+      case ColumnOp::kGreater: return Mask(_mm256_cmpgt_epi64(x, v));
+      case ColumnOp::kGreaterEqual: return ~Mask(_mm256_cmpgt_epi64(v, x)) & 0xf;
+      case ColumnOp::kEqual: return Mask(_mm256_cmpeq_epi64(x, v));
+      default: return ~Mask(_mm256_cmpeq_epi64(x, v)) & 0xf;
+    }
+  }
+
+  COLUMNAR_AVX2 static int Mask(__m256i m)
+  {
+    return _mm256_movemask_pd(_mm256_castsi256_pd(m));
+  }
+};
+
+template <> struct HasAvx2Scan<float> : std::true_type {};
+template <> struct HasAvx2Scan<double> : std::true_type {};
+template <> struct HasAvx2Scan<int32_t> : std::true_type {};
+template <> struct HasAvx2Scan<int64_t> : std::true_type {};
+
+template <typename T>
+COLUMNAR_AVX2 uint64_t ColumnScanAvx2(const T* data, int n, ColumnOp op, const T& value)
+{
+  const int lanes = Avx2Lanes<T>::kLanes;
+  uint64_t bits = 0;
+  int i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    bits |= static_cast<uint64_t>(Avx2Lanes<T>::Compare(data + i, op, value)) << i;
+  }
+  if (i < n) {
+    bits |= ColumnScanScalar(data + i, n - i, op, value) << i;
+  }
+  return bits;
+}
+
+template <typename T>
+uint64_t ColumnScan(const T* data, int n, ColumnOp op, const T& value, std::true_type)
+{
+  if (ColumnScanHasAvx2()) {
+    return ColumnScanAvx2(data, n, op, value);
+  }
+  return ColumnScanScalar(data, n, op, value);
+}
+#endif
+
+template <typename T>
+uint64_t ColumnScan(const T* data, int n, ColumnOp op, const T& value, std::false_type)
+{
+  return ColumnScanScalar(data, n, op, value);
+}
+
+// Vectorized when T has an AVX2 scan and the CPU supports it.
+template <typename T> uint64_t ColumnScan(const T* data, int n, ColumnOp op, const T& value)
+{
+  return ColumnScan(data, n, op, value, HasAvx2Scan<T>());
+}
+
+// LatestFixedQueue for wide records that are scanned by a few fields.
+//
+// Rows are declared by their column types, e.g.
+// ColumnarFixedQueue<int64_t, double, int32_t>, and each column is stored in
+// its own contiguous ring (struct of arrays), so a filter on one field only
+// reads that field. Filters compare a column with a value into a Selection
+// bitmap, 64 rows at a time and with AVX2 where available; only the rows left
+// in the selection are then materialized. Like LatestFixedQueue, the oldest
+// row is dropped once cap rows are held.
+//
+//   auto sel = queue.Select();
+//   queue.Filter<1>(sel, ColumnOp::kGreater, 100.0);
+//   queue.Filter<2>(sel, ColumnOp::kEqual, 3);
+//   queue.GetItems(sel, rows);
+template <typename... Columns>
+class ColumnarFixedQueue {
+public:
+  typedef std::tuple<Columns...> Row;
+
+  template <size_t I> using ColumnType = typename std::tuple_element<I, Row>::type;
+
+  // A set of rows identified by their push sequence. Filters narrow it down;
+  // rows evicted after Select are dropped by the next Filter or GetItems.
+  class Selection {
+  public:
+    Selection() : begin_(0), end_(0) {}
+
+    // Number of selected rows, including rows evicted since the last Filter.
+    int Count() const
+    {
+      int count = 0;
+      for (uint64_t word : bits_) {
+        count += __builtin_popcountll(word);
+      }
+      return count;
+    }
+
+    bool IsEmpty() const
+    {
+      return Count() == 0;
+    }
+
+  private:
+    friend class ColumnarFixedQueue;
+
+    // ANDs mask into the n bits starting at pos; bits of mask above n are ignored.
+    void And(int64_t pos, uint64_t mask, int n)
+    {
+      if (n < 64) {
+        mask |= ~((uint64_t(1) << n) - 1);
+      }
+      size_t word = pos / 64;
+      int shift = pos % 64;
+      if (shift == 0) {
+        bits_[word] &= mask;
+        return;
+      }
+      bits_[word] &= (mask << shift) | ((uint64_t(1) << shift) - 1);
+      if (word + 1 < bits_.size()) {
+        bits_[word + 1] &= (mask >> (64 - shift)) | ~((uint64_t(1) << shift) - 1);
+      }
+    }
+
+    int64_t begin_;  // sequence of the first row
+    int64_t end_;    // one past the sequence of the last row
+    std::vector<uint64_t> bits_;
+  };
+
+  explicit ColumnarFixedQueue(int cap)
+    : cap_(cap < 1 ? 1 : cap), columns_(std::vector<Columns>(cap_)...), next_(0), size_(0)
+  {
+  }
+
+  ~ColumnarFixedQueue() {}
+
+  bool IsFull() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_ >= cap_;
+  }
+
+  bool IsEmpty() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_ <= 0;
+  }
+
+  int Size() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  int Capacity() const
+  {
+    return cap_;
+  }
+
+  void Push(const Columns&... values)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Store(Slot(next_), std::forward_as_tuple(values...), Indexes());
+    next_++;
+    if (size_ < cap_) {
+      size_++;
+    }
+  }
+
+  void Push(const Row& row)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Store(Slot(next_), row, Indexes());
+    next_++;
+    if (size_ < cap_) {
+      size_++;
+    }
+  }
+
+  // Selects every row currently held.
+  Selection Select() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Selection sel;
+    sel.begin_ = next_ - size_;
+    sel.end_ = next_;
+    sel.bits_.assign((size_ + 63) / 64, ~uint64_t(0));
+    if (size_ % 64 != 0) {
+      sel.bits_.back() = (uint64_t(1) << (size_ % 64)) - 1;
+    }
+    return sel;
+  }
+
+  // Keeps the selected rows whose column I compares true with value.
+  template <size_t I>
+  void Filter(Selection& sel, ColumnOp op, const ColumnType<I>& value) const
+  {
+    static_assert(std::is_arithmetic<ColumnType<I>>::value,
+                  "ColumnOp filters need an arithmetic column, use FilterIf");
+    std::lock_guard<std::mutex> lock(mutex_);
+    const ColumnType<I>* column = std::get<I>(columns_).data();
+    ScanInternal(sel, [&](int slot, int n) {
+      return ColumnScan(column + slot, n, op, value);
+    });
+  }
+
+  // Keeps the selected rows for which pred(column I) returns true. Scalar,
+  // for columns or conditions that Filter does not cover.
+  template <size_t I, typename Predicate>
+  void FilterIf(Selection& sel, Predicate pred) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::vector<ColumnType<I>>& column = std::get<I>(columns_);
+    ScanInternal(sel, [&](int slot, int n) {
+      uint64_t bits = 0;
+      for (int i = 0; i < n; i++) {
+        bits |= static_cast<uint64_t>(pred(column[slot + i]) ? 1 : 0) << i;
+      }
+      return bits;
+    });
+  }
+
+  // Appends the selected rows still held, oldest first, at most maxCount if
+  // maxCount > 0. data_arr is cleared first unless append is set.
+  void GetItems(const Selection& sel, std::vector<Row>& data_arr, int maxCount = 0, bool append = false) const
+  {
+    if (!append) {
+      data_arr.clear();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    VisitInternal(sel, maxCount, [&](int slot) {
+      data_arr.push_back(Load(slot, Indexes()));
+    });
+  }
+
+  // Same as GetItems for a single column.
+  template <size_t I>
+  void GetColumn(const Selection& sel, std::vector<ColumnType<I>>& data_arr, int maxCount = 0,
+                 bool append = false) const
+  {
+    if (!append) {
+      data_arr.clear();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::vector<ColumnType<I>>& column = std::get<I>(columns_);
+    VisitInternal(sel, maxCount, [&](int slot) {
+      data_arr.push_back(column[slot]);
+    });
+  }
+
+  // All rows currently held, oldest first.
+  void GetItems(std::vector<Row>& data_arr, int maxCount = 0, bool append = false) const
+  {
+    GetItems(Select(), data_arr, maxCount, append);
+  }
+
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_ = 0;
+  }
+
+private:
+  template <size_t... Is> struct IndexList {};
+  template <size_t N, size_t... Is> struct MakeIndexList : MakeIndexList<N - 1, N - 1, Is...> {};
+  template <size_t... Is> struct MakeIndexList<0, Is...> {
+    typedef IndexList<Is...> type;
+  };
+  typedef typename MakeIndexList<sizeof...(Columns)>::type Indexes;
+
+  int Slot(int64_t seq) const
+  {
+    return static_cast<int>(seq % cap_);
+  }
+
+  template <typename Tuple, size_t... Is>
+  void Store(int slot, const Tuple& row, IndexList<Is...>)
+  {
+    int expand[] = {0, (std::get<Is>(columns_)[slot] = std::get<Is>(row), 0)...};
+    (void)expand;
+  }
+
+  template <size_t... Is>
+  Row Load(int slot, IndexList<Is...>) const
+  {
+    return Row(std::get<Is>(columns_)[slot]...);
+  }
+
+  // Caller holds mutex_. Drops evicted rows from sel and ANDs scan(slot, n),
+  // the match bitmask of n <= 64 consecutive slots, into the rest. Runs never
+  // cross the end of the ring, so column data is always contiguous.
+  template <typename Scan>
+  void ScanInternal(Selection& sel, Scan scan) const
+  {
+    int64_t oldest = next_ - size_;
+    int64_t seq = sel.begin_;
+    for (; seq < sel.end_ && seq < oldest; seq += 64) {
+      int n = static_cast<int>(std::min<int64_t>(64, std::min(sel.end_, oldest) - seq));
+      sel.And(seq - sel.begin_, 0, n);
+    }
+    for (seq = std::max(sel.begin_, oldest); seq < sel.end_;) {
+      int slot = Slot(seq);
+      int n = static_cast<int>(std::min<int64_t>(std::min<int64_t>(64, sel.end_ - seq), cap_ - slot));
+      if (Word(sel, seq - sel.begin_, n) != 0) {
+        sel.And(seq - sel.begin_, scan(slot, n), n);
+      }
+      seq += n;
+    }
+  }
+
+  // The n selection bits starting at pos, to skip runs that are already empty.
+  static uint64_t Word(const Selection& sel, int64_t pos, int n)
+  {
+    size_t word = pos / 64;
+    int shift = pos % 64;
+    uint64_t bits = sel.bits_[word] >> shift;
+    if (shift != 0 && word + 1 < sel.bits_.size()) {
+      bits |= sel.bits_[word + 1] << (64 - shift);
+    }
+    return n < 64 ? bits & ((uint64_t(1) << n) - 1) : bits;
+  }
+
+  // Caller holds mutex_. Calls visit(slot) for the selected rows still held.
+  template <typename Visit>
+  void VisitInternal(const Selection& sel, int maxCount, Visit visit) const
+  {
+    int64_t oldest = next_ - size_;
+    int count = 0;
+    for (size_t w = 0; w < sel.bits_.size(); w++) {
+      uint64_t bits = sel.bits_[w];
+      while (bits != 0) {
+        int64_t seq = sel.begin_ + static_cast<int64_t>(w * 64) + __builtin_ctzll(bits);
+        bits &= bits - 1;
+        if (seq < oldest) {
+          continue;
+        }
+        visit(Slot(seq));
+        if (maxCount > 0 && ++count >= maxCount) {
+          return;
+        }
+      }
+    }
+  }
+
+private:
+  int cap_;
+  std::tuple<std::vector<Columns>...> columns_;
+  int64_t next_;  // sequence of the next push
+  int size_;
+  mutable std::mutex mutex_;
+};
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// LatestFixedQueue for long histories of numeric samples.
+//
+// Instead of one heap-allocated shared_ptr per entry, values are kept inline
+// in blocks of kBlockSize. The newest block stays uncompressed; once full it
+// is sealed and encoded: integers with frame-of-reference bit-packing (block
+// minimum plus the bits needed for max - min), floating point values with
+// Gorilla XOR encoding against the previous value. Reads decode block by block,
+// so scans are sequential. Like LatestFixedQueue, the oldest value is dropped
+// once cap values are held.
+template <typename DataType>
+class CompressedFixedQueue {
+  static_assert(std::is_arithmetic<DataType>::value,
+                "CompressedFixedQueue needs an arithmetic DataType");
+  static_assert(sizeof(DataType) <= sizeof(uint64_t),
+                "CompressedFixedQueue needs a DataType of at most 64 bits");
+
+public:
+  static const int kBlockSize = 128;
+
+  explicit CompressedFixedQueue(int cap)
+    : cap_(cap < 1 ? 1 : cap), block_size_(cap_ < kBlockSize ? cap_ : static_cast<int>(kBlockSize))
+  {
+    ClearInternal();
+  }
+
+  ~CompressedFixedQueue() {}
+
+  bool IsFull() const
+  {
+    return size_ >= cap_;
+  }
+
+  bool IsEmpty() const
+  {
+    return size_ <= 0;
+  }
+
+  int Size() const
+  {
+    return size_;
+  }
+
+  int Capacity() const
+  {
+    return cap_;
+  }
+
+  void Push(DataType value)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_[open_count_++] = value;
+    if (open_count_ == block_size_) {
+      blocks_.push_back(Block());
+      Encode(blocks_.back());
+      open_count_ = 0;
+    }
+
+    if (IsFull()) {
+      // the oldest value is in the first sealed block: block_size_ <= cap_
+      if (++skip_ == blocks_.front().count) {
+        blocks_.pop_front();
+        skip_ = 0;
+      }
+    } else {
+      size_++;
+    }
+  }
+
+  // Appends the values accepted by filter(DataType), oldest first, at most
+  // maxCount if maxCount > 0. data_arr is cleared first unless append is set.
+  template <typename Filter>
+  void GetItems(std::vector<DataType>& data_arr, Filter filter, int maxCount = 0, bool append = false)
+  {
+    if (!append) {
+      data_arr.clear();
+    }
+    if (maxCount <= 0) {
+      maxCount = cap_;
+    }
+    int count = 0;
+    ForEach([&](DataType value) {
+      if (filter(value)) {
+        data_arr.push_back(value);
+        count++;
+      }
+      return count < maxCount;
+    });
+  }
+
+  void GetItems(std::vector<DataType>& data_arr, int maxCount = 0, bool append = false)
+  {
+    if (!append) {
+      data_arr.clear();
+    }
+    int size = size_;
+    data_arr.reserve(data_arr.size() + (maxCount > 0 && maxCount < size ? maxCount : size));
+    GetItems(data_arr, AcceptAll(), maxCount, true);
+  }
+
+  // Decodes the values oldest first and calls bool visitor(DataType) on each
+  // until it returns false. Runs under the queue lock. Returns the number of
+  // values visited.
+  template <typename Visitor>
+  int ForEach(Visitor&& visitor)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DataType buf[kBlockSize];
+    int visited = 0;
+    for (size_t b = 0; b < blocks_.size(); b++) {
+      Decode(blocks_[b], buf);
+      for (int i = (b == 0 ? skip_ : 0); i < blocks_[b].count; i++) {
+        visited++;
+        if (!visitor(buf[i])) {
+          return visited;
+        }
+      }
+    }
+    for (int i = 0; i < open_count_; i++) {
+      visited++;
+      if (!visitor(open_[i])) {
+        break;
+      }
+    }
+    return visited;
+  }
+
+  // Bytes held by the encoded history, to compare with the size of a
+  // LatestFixedQueue of the same values.
+  size_t MemoryBytes() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = sizeof(*this);
+    for (const Block& block : blocks_) {
+      bytes += sizeof(Block) + block.words.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+  }
+
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClearInternal();
+  }
+
+private:
+  typedef typename std::conditional<sizeof(DataType) <= 4, uint32_t, uint64_t>::type Bits;
+  // integers are widened with their signedness so that max - min never overflows
+  typedef typename std::conditional<std::is_signed<DataType>::value, int64_t, uint64_t>::type Wide;
+
+  static const int kBits = sizeof(Bits) * 8;
+
+  struct Block
+  {
+    std::vector<uint64_t> words;
+    int count;
+    uint64_t base;  // frame of reference (integers)
+    int width;      // bits per packed value (integers)
+  };
+
+  struct AcceptAll
+  {
+    bool operator()(DataType value) const
+    {
+      (void)value;
+      return true;
+    }
+  };
+
+  class BitWriter {
+  public:
+    explicit BitWriter(std::vector<uint64_t>& words) : words_(words), pos_(0) {}
+
+    void Write(uint64_t value, int nbits)
+    {
+      if (nbits == 0) {
+        return;
+      }
+      if (nbits < 64) {
+        value &= (uint64_t(1) << nbits) - 1;
+      }
+      size_t idx = pos_ / 64;
+      int off = pos_ % 64;
+      if (idx + 1 >= words_.size()) {
+        words_.resize(idx + 2, 0);
+      }
+      words_[idx] |= value << off;
+      if (off + nbits > 64) {
+        words_[idx + 1] |= value >> (64 - off);
+      }
+      pos_ += nbits;
+    }
+
+    size_t Bits() const
+    {
+      return pos_;
+    }
+
+  private:
+    std::vector<uint64_t>& words_;
+    size_t pos_;
+  };
+
+  class BitReader {
+  public:
+    explicit BitReader(const std::vector<uint64_t>& words) : words_(words), pos_(0) {}
+
+    uint64_t Read(int nbits)
+    {
+      if (nbits == 0) {
+        return 0;
+      }
+      size_t idx = pos_ / 64;
+      int off = pos_ % 64;
+      uint64_t value = words_[idx] >> off;
+      if (off + nbits > 64) {
+        value |= words_[idx + 1] << (64 - off);
+      }
+      pos_ += nbits;
+      return nbits < 64 ? value & ((uint64_t(1) << nbits) - 1) : value;
+    }
+
+  private:
+    const std::vector<uint64_t>& words_;
+    size_t pos_;
+  };
+
+  static int LeadingZeros(Bits x)
+  {
+    return __builtin_clzll(x) - (64 - kBits);
+  }
+
+  static int TrailingZeros(Bits x)
+  {
+    return __builtin_ctzll(x);
+  }
+
+  static Bits ToBits(DataType value)
+  {
+    Bits bits = 0;
+    memcpy(&bits, &value, sizeof(DataType));
+    return bits;
+  }
+
+  static DataType FromBits(Bits bits)
+  {
+    DataType value;
+    memcpy(&value, &bits, sizeof(DataType));
+    return value;
+  }
+
+  // Caller holds mutex_. Encodes the full open block into block.
+  void Encode(Block& block)
+  {
+    block.count = open_count_;
+    EncodeValues(block, std::is_floating_point<DataType>());
+    std::vector<uint64_t>(block.words).swap(block.words);  // shrink to fit
+  }
+
+  void Decode(const Block& block, DataType* out) const
+  {
+    DecodeValues(block, out, std::is_floating_point<DataType>());
+  }
+
+  // Frame of reference: values are stored as value - min in width bits.
+  void EncodeValues(Block& block, std::false_type)
+  {
+    Wide min = static_cast<Wide>(open_[0]);
+    Wide max = min;
+    for (int i = 1; i < block.count; i++) {
+      Wide v = static_cast<Wide>(open_[i]);
+      min = v < min ? v : min;
+      max = v > max ? v : max;
+    }
+    uint64_t range = static_cast<uint64_t>(max) - static_cast<uint64_t>(min);
+    block.base = static_cast<uint64_t>(min);
+    block.width = range == 0 ? 0 : 64 - __builtin_clzll(range);
+
+    BitWriter writer(block.words);
+    for (int i = 0; i < block.count; i++) {
+      writer.Write(static_cast<uint64_t>(static_cast<Wide>(open_[i])) - block.base, block.width);
+    }
+  }
+
+  void DecodeValues(const Block& block, DataType* out, std::false_type) const
+  {
+    BitReader reader(block.words);
+    for (int i = 0; i < block.count; i++) {
+      out[i] = static_cast<DataType>(static_cast<Wide>(block.base + reader.Read(block.width)));
+    }
+  }
+
+  // Gorilla: XOR with the previous value; 0 bit if unchanged, else the
+  // meaningful bits, reusing the previous leading/trailing zero window when
+  // they fit in it (control 10) or with a new 5-bit/6-bit window (control 11).
+  void EncodeValues(Block& block, std::true_type)
+  {
+    BitWriter writer(block.words);
+    Bits prev = ToBits(open_[0]);
+    writer.Write(prev, kBits);
+    int prev_lead = -1;
+    int prev_trail = 0;
+    for (int i = 1; i < block.count; i++) {
+      Bits cur = ToBits(open_[i]);
+      Bits x = cur ^ prev;
+      prev = cur;
+      if (x == 0) {
+        writer.Write(0, 1);
+        continue;
+      }
+      int lead = LeadingZeros(x);
+      int trail = TrailingZeros(x);
+      if (lead > 31) {
+        lead = 31;
+      }
+      if (prev_lead >= 0 && lead >= prev_lead && trail >= prev_trail) {
+        writer.Write(1, 2);  // control 10, bits are written LSB first
+        writer.Write(x >> prev_trail, kBits - prev_lead - prev_trail);
+      } else {
+        int len = kBits - lead - trail;
+        writer.Write(3, 2);  // control 11
+        writer.Write(lead, 5);
+        writer.Write(len - 1, 6);
+        writer.Write(x >> trail, len);
+        prev_lead = lead;
+        prev_trail = trail;
+      }
+    }
+  }
+
+  void DecodeValues(const Block& block, DataType* out, std::true_type) const
+  {
+    BitReader reader(block.words);
+    Bits prev = static_cast<Bits>(reader.Read(kBits));
+    out[0] = FromBits(prev);
+    int prev_lead = 0;
+    int prev_trail = 0;
+    for (int i = 1; i < block.count; i++) {
+      if (reader.Read(1) != 0) {
+        if (reader.Read(1) != 0) {
+          prev_lead = static_cast<int>(reader.Read(5));
+          prev_trail = kBits - prev_lead - (static_cast<int>(reader.Read(6)) + 1);
+        }
+        prev ^= static_cast<Bits>(reader.Read(kBits - prev_lead - prev_trail) << prev_trail);
+      }
+      out[i] = FromBits(prev);
+    }
+  }
+
+  void ClearInternal()
+  {
+    blocks_.clear();
+    skip_ = 0;
+    open_count_ = 0;
+    size_ = 0;
+  }
+
+private:
+  std::atomic<int> size_;
+  int cap_;
+  int block_size_;
+  std::deque<Block> blocks_;  // sealed blocks, oldest first
+  int skip_;                  // evicted values at the front of blocks_.front()
+  DataType open_[kBlockSize];
+  int open_count_;
+  mutable std::mutex mutex_;
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Keyed LatestFixedQueue that keeps only the newest value per key.
+//
+// A push for a key that is already queued replaces the queued value in place
+// without changing its position, so consumers pop each key at most once with
+// its latest value. Keys are found through an open-addressing (linear probing)
+// index from key to ring slot. When the ring is full, a push for a new key
+// evicts the oldest entry, as LatestFixedQueue does.
+template <typename KeyType, typename DataType, typename Hash = std::hash<KeyType>>
+class ConflatingFixedQueue {
+public:
+  explicit ConflatingFixedQueue(int cap)
+    : cap_(cap), ring_(cap), keys_(cap), index_(IndexSize(cap)),
+      index_mask_(index_.size() - 1), is_stopped_(false)
+  {
+    ClearInternal();
+  }
+
+  ~ConflatingFixedQueue() {}
+
+  bool IsFull() const
+  {
+    return size_ >= cap_;
+  }
+
+  bool IsEmpty() const
+  {
+    return size_ <= 0;
+  }
+
+  int Size() const
+  {
+    return size_;
+  }
+
+  // Number of pushes that replaced a queued value since the last Clear.
+  long Conflated() const
+  {
+    return conflated_;
+  }
+
+  // Returns true if the value replaced one already queued for key.
+  bool Push(const KeyType& key, const std::shared_ptr<DataType>& data_ptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_stopped_ || cap_ <= 0) {
+      return false;
+    }
+
+    size_t hash = hasher_(key);
+    size_t pos = Find(key, hash);
+    if (index_[pos].slot >= 0) {
+      ring_[index_[pos].slot] = data_ptr;
+      conflated_++;
+      return true;
+    }
+
+    if (IsFull()) {
+      EraseIndex(Find(keys_[front_], hasher_(keys_[front_])));
+      ring_[front_] = nullptr;
+      front_ = (front_ + 1) % cap_;
+      size_--;
+      // the erase may have shifted entries, look the free position up again
+      pos = Find(key, hash);
+    }
+
+    int slot = (front_ + size_) % cap_;
+    ring_[slot] = data_ptr;
+    keys_[slot] = key;
+    index_[pos].slot = slot;
+    index_[pos].hash = hash;
+    size_++;
+    cv_.notify_one();
+    return false;
+  }
+
+  bool Pop(std::shared_ptr<DataType>& data_ptr, KeyType* key = nullptr)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return is_stopped_ || !IsEmpty(); });
+
+    if (is_stopped_) {
+      return false;
+    }
+
+    EraseIndex(Find(keys_[front_], hasher_(keys_[front_])));
+    data_ptr = ring_[front_];
+    if (key) {
+      *key = keys_[front_];
+    }
+    ring_[front_] = nullptr;
+    front_ = (front_ + 1) % cap_;
+    size_--;
+    return true;
+  }
+
+  // Latest value queued for key, without removing it.
+  bool Peek(const KeyType& key, std::shared_ptr<DataType>& data_ptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t pos = Find(key, hasher_(key));
+    if (index_[pos].slot < 0) {
+      return false;
+    }
+    data_ptr = ring_[index_[pos].slot];
+    return true;
+  }
+
+  void GetItems(std::vector<DataType>& data_arr, int maxCount = 0)
+  {
+    data_arr.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (maxCount <= 0 || maxCount > size_) {
+      maxCount = size_;
+    }
+    for (int i = 0, j = front_; i < maxCount; i++, j = (j + 1) % cap_) {
+      data_arr.emplace_back(*ring_[j]);
+    }
+  }
+
+  bool Start()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopped_ = false;
+    ClearInternal();
+    return true;
+  }
+
+  void Stop()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopped_ = true;
+    ClearInternal();
+    cv_.notify_all();
+  }
+
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClearInternal();
+  }
+
+private:
+  struct IndexEntry
+  {
+    int slot;  // ring slot, -1 if the entry is free
+    size_t hash;
+  };
+
+  // Power of two with a load factor of at most 1/2.
+  static size_t IndexSize(int cap)
+  {
+    size_t n = 2;
+    while (cap > 0 && n < static_cast<size_t>(cap) * 2) {
+      n <<= 1;
+    }
+    return n;
+  }
+
+  // Position of key in the index, or the free position where it would go.
+  size_t Find(const KeyType& key, size_t hash) const
+  {
+    size_t pos = hash & index_mask_;
+    while (index_[pos].slot >= 0) {
+      if (index_[pos].hash == hash && keys_[index_[pos].slot] == key) {
+        break;
+      }
+      pos = (pos + 1) & index_mask_;
+    }
+    return pos;
+  }
+
+  // Backward-shift deletion keeps probe chains intact without tombstones.
+  void EraseIndex(size_t pos)
+  {
+    size_t hole = pos;
+    size_t next = pos;
+    while (true) {
+      next = (next + 1) & index_mask_;
+      if (index_[next].slot < 0) {
+        break;
+      }
+      size_t home = index_[next].hash & index_mask_;
+      bool stays = hole <= next ? (hole < home && home <= next)
+                                : (hole < home || home <= next);
+      if (!stays) {
+        index_[hole] = index_[next];
+        hole = next;
+      }
+    }
+    index_[hole].slot = -1;
+  }
+
+  void ClearInternal()
+  {
+    size_ = 0;
+    front_ = 0;
+    conflated_ = 0;
+    for (auto& data_ptr : ring_) {
+      data_ptr = nullptr;
+    }
+    for (auto& entry : index_) {
+      entry.slot = -1;
+    }
+  }
+
+private:
+  std::atomic<int> size_;
+  int cap_;
+  int front_;
+  std::atomic<long> conflated_;
+  std::vector<std::shared_ptr<DataType>> ring_;
+  std::vector<KeyType> keys_;
+  std::vector<IndexEntry> index_;
+  size_t index_mask_;
+  Hash hasher_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool is_stopped_;
+};
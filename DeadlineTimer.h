@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// One thread running callbacks at deadlines, shared by every queue of the
+// process, so that waiting for many deadlines costs one sleeping thread
+// instead of one per waiter. Callbacks run on the timer thread one at a
+// time and must be short.
+class DeadlineTimer {
+public:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+  typedef std::function<void()> Callback;
+
+  // Never destroyed, so that queues with static storage duration can still
+  // cancel their timers at exit.
+  static DeadlineTimer& Instance()
+  {
+    static DeadlineTimer* timer = new DeadlineTimer();
+    return *timer;
+  }
+
+  // Returns an id for Cancel, never 0.
+  uint64_t Schedule(TimePoint when, const Callback& callback)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_started_) {
+      std::thread(&DeadlineTimer::Run, this).detach();
+      thread_started_ = true;
+    }
+    uint64_t id = ++last_id_;
+    timers_.insert(std::make_pair(std::make_pair(when, id), callback));
+    cv_.notify_one();
+    return id;
+  }
+
+  // Drops the timer if it has not run yet and returns whether it did, i.e.
+  // whether the callback will never be called. With wait set, also waits for
+  // a running callback to return, so the caller may free what it uses; do
+  // not wait while holding a lock the callback takes.
+  bool Cancel(uint64_t id, bool wait = false)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto it = timers_.begin(); it != timers_.end(); ++it) {
+      if (it->first.second == id) {
+        timers_.erase(it);
+        return true;
+      }
+    }
+    if (wait) {
+      done_cv_.wait(lock, [this, id] { return running_id_ != id; });
+    }
+    return false;
+  }
+
+private:
+  DeadlineTimer() : thread_started_(false), last_id_(0), running_id_(0) {}
+
+  void Run()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      if (timers_.empty()) {
+        cv_.wait(lock);
+        continue;
+      }
+      auto first = timers_.begin();
+      // a copy: Cancel may erase the node while wait_until drops the lock
+      TimePoint when = first->first.first;
+      if (when > std::chrono::steady_clock::now()) {
+        cv_.wait_until(lock, when);
+        continue;
+      }
+      Callback callback = first->second;
+      running_id_ = first->first.second;
+      timers_.erase(first);
+      lock.unlock();
+      callback();
+      lock.lock();
+      running_id_ = 0;
+      done_cv_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  std::map<std::pair<TimePoint, uint64_t>, Callback> timers_;  // by deadline, then id
+  bool thread_started_;
+  uint64_t last_id_;
+  uint64_t running_id_;
+};
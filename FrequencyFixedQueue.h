@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+template <typename KeyType> struct FrequencyItem {
+  KeyType key;
+  uint64_t count;  // estimated frequency, never below the true one
+  uint64_t error;  // count - error is a guaranteed lower bound
+};
+
+// Space-Saving summary over at most cap counters. A key that is not tracked
+// replaces the key with the minimum count and inherits that count as its
+// error, so memory stays fixed whatever the key cardinality. Any key with a
+// true frequency above total / cap is guaranteed to be tracked.
+//
+// Counters live in an indexed min-heap, so an update is O(log cap) and works
+// for weighted updates and for merging summaries. Not thread-safe, see
+// FrequencyFixedQueue.
+template <typename KeyType, typename Hash = std::hash<KeyType>> class SpaceSaving {
+public:
+  explicit SpaceSaving(int cap) : _cap(cap < 1 ? 1 : cap), _total(0) {
+    _heap.reserve(_cap);
+    _index.reserve(_cap);
+  }
+
+  void Push(const KeyType& key, uint64_t weight = 1) {
+    _total += weight;
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+      _heap[it->second].count += weight;
+      SiftDown(it->second);
+    } else if (static_cast<int>(_heap.size()) < _cap) {
+      FrequencyItem<KeyType> item = {key, weight, 0};
+      _heap.push_back(item);
+      _index[key] = _heap.size() - 1;
+      SiftUp(_heap.size() - 1);
+    } else {
+      FrequencyItem<KeyType>& min = _heap[0];
+      _index.erase(min.key);
+      min.error = min.count;
+      min.count += weight;
+      min.key = key;
+      _index[key] = 0;
+      SiftDown(0);
+    }
+  }
+
+  // Mergeable summaries: a key missing from one side may have had up to that
+  // side's minimum count, so the minimum is added to both count and error.
+  void Merge(const SpaceSaving& other) {
+    uint64_t min_this = MinCount();
+    uint64_t min_other = other.MinCount();
+    std::unordered_map<KeyType, FrequencyItem<KeyType>, Hash> merged;
+    for (const auto& item : _heap) {
+      FrequencyItem<KeyType> m = {item.key, item.count + min_other, item.error + min_other};
+      merged.insert(std::make_pair(item.key, m));
+    }
+    for (const auto& item : other._heap) {
+      auto it = merged.find(item.key);
+      if (it != merged.end()) {
+        it->second.count += item.count - min_other;
+        it->second.error += item.error - min_other;
+      } else {
+        FrequencyItem<KeyType> m = {item.key, item.count + min_this, item.error + min_this};
+        merged.insert(std::make_pair(item.key, m));
+      }
+    }
+
+    std::vector<FrequencyItem<KeyType>> items;
+    items.reserve(merged.size());
+    for (const auto& kv : merged) {
+      items.push_back(kv.second);
+    }
+    SortDescending(items);
+    if (static_cast<int>(items.size()) > _cap) {
+      items.resize(_cap);
+    }
+
+    _total += other._total;
+    _heap.clear();
+    _index.clear();
+    for (const auto& item : items) {
+      _heap.push_back(item);
+      _index[item.key] = _heap.size() - 1;
+      SiftUp(_heap.size() - 1);
+    }
+  }
+
+  // Counters sorted by descending count.
+  void GetItems(std::vector<FrequencyItem<KeyType>>& data_arr) const {
+    data_arr.assign(_heap.begin(), _heap.end());
+    SortDescending(data_arr);
+  }
+
+  // A tracked key missing from the summary has a true count of at most this.
+  uint64_t MinCount() const {
+    return static_cast<int>(_heap.size()) < _cap ? 0 : _heap[0].count;
+  }
+
+  uint64_t Total() const { return _total; }
+
+  int Size() const { return static_cast<int>(_heap.size()); }
+
+  void Clear() {
+    _heap.clear();
+    _index.clear();
+    _total = 0;
+  }
+
+  static void SortDescending(std::vector<FrequencyItem<KeyType>>& items) {
+    std::sort(items.begin(), items.end(),
+              [](const FrequencyItem<KeyType>& a, const FrequencyItem<KeyType>& b) {
+                return a.count > b.count;
+              });
+  }
+
+private:
+  void Swap(size_t a, size_t b) {
+    std::swap(_heap[a], _heap[b]);
+    _index[_heap[a].key] = a;
+    _index[_heap[b].key] = b;
+  }
+
+  void SiftUp(size_t i) {
+    while (i > 0) {
+      size_t parent = (i - 1) / 2;
+      if (_heap[parent].count <= _heap[i].count)
+        break;
+      Swap(parent, i);
+      i = parent;
+    }
+  }
+
+  void SiftDown(size_t i) {
+    while (true) {
+      size_t smallest = i;
+      size_t left = 2 * i + 1;
+      size_t right = left + 1;
+      if (left < _heap.size() && _heap[left].count < _heap[smallest].count)
+        smallest = left;
+      if (right < _heap.size() && _heap[right].count < _heap[smallest].count)
+        smallest = right;
+      if (smallest == i)
+        break;
+      Swap(smallest, i);
+      i = smallest;
+    }
+  }
+
+  int _cap;
+  uint64_t _total;
+  std::vector<FrequencyItem<KeyType>> _heap;
+  std::unordered_map<KeyType, size_t, Hash> _index;
+};
+
+// Frequency top-K ("top 100 most frequent keys") with bounded memory, the
+// frequency counterpart of DescendingFixedQueue. Pushes go to one of several
+// Space-Saving shards picked by the calling thread, so producers on different
+// threads rarely share a lock; PopAll merges the shards on read. Every result
+// carries its error bound: the true count lies in [count - error, count].
+template <typename KeyType, typename Hash = std::hash<KeyType>> class FrequencyFixedQueue {
+public:
+  // cap is the number of counters per shard; a larger cap than the number of
+  // results wanted tightens the error bounds.
+  explicit FrequencyFixedQueue(int cap, int shards = 1) : _cap(cap < 1 ? 1 : cap) {
+    for (int i = 0; i < (shards < 1 ? 1 : shards); i++) {
+      _shards.emplace_back(new Shard(_cap));
+    }
+  }
+
+  void Push(const KeyType& key, uint64_t weight = 1) {
+    Shard& shard = *_shards[std::hash<std::thread::id>()(std::this_thread::get_id()) % _shards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.summary.Push(key, weight);
+  }
+
+  // Merged top items by descending count, at most maxCount if maxCount > 0.
+  // The shards are reset afterwards.
+  void PopAll(std::vector<FrequencyItem<KeyType>>& data_arr, int maxCount = 0) {
+    Collect(data_arr, maxCount, true);
+  }
+
+  // Same as PopAll without resetting the shards.
+  void GetItems(std::vector<FrequencyItem<KeyType>>& data_arr, int maxCount = 0) {
+    Collect(data_arr, maxCount, false);
+  }
+
+  // Total weight pushed since the last PopAll.
+  uint64_t Total() {
+    uint64_t total = 0;
+    for (auto& shard : _shards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      total += shard->summary.Total();
+    }
+    return total;
+  }
+
+private:
+  struct Shard {
+    explicit Shard(int cap) : summary(cap) {}
+    std::mutex mutex;
+    SpaceSaving<KeyType, Hash> summary;
+  };
+
+  void Collect(std::vector<FrequencyItem<KeyType>>& data_arr, int maxCount, bool reset) {
+    SpaceSaving<KeyType, Hash> merged(_cap);
+    for (auto& shard : _shards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      merged.Merge(shard->summary);
+      if (reset)
+        shard->summary.Clear();
+    }
+    merged.GetItems(data_arr);
+    if (maxCount > 0 && static_cast<int>(data_arr.size()) > maxCount)
+      data_arr.resize(maxCount);
+  }
+
+  int _cap;
+  std::vector<std::unique_ptr<Shard>> _shards;
+};
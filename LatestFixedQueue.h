@@ -1,22 +1,76 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cmath>
 #include <condition_variable>
-#include <functional>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
 #include <mutex>
-#include <thread>
+#include <random>
 #include <vector>
+#include <time.h>
+#include "DeadlineTimer.h"
+#include "QueueTracer.h"
+#include "Watermark.h"
 
-template <typename DataType>
+// Allocator places the ring storage, see NumaAllocator.h.
+template <typename DataType, typename Allocator = std::allocator<DataType>>
 class LatestFixedQueue {
 public:
-  explicit LatestFixedQueue(int cap)
-    : cap_(cap), ring_(cap), is_stopped_(false), is_stopping_(false)
+  enum class PushStatus {
+    kOk,
+    kStopping,  // rejected while Stop drains the queue
+    kStopped,
+    kSampledOut,  // dropped by the overload sampling, see SetSampling
+  };
+
+  enum class SamplingMode {
+    kNone,       // keep the latest cap entries
+    kReservoir,  // uniform sample of the pushes since the overload began
+    kDecimate,   // keep every Nth push
+  };
+
+  // max_age_ms > 0 additionally evicts entries older than max_age_ms, see
+  // SetMaxAge.
+  explicit LatestFixedQueue(int cap, int max_age_ms = 0, const Allocator& alloc = Allocator())
+    : cap_(cap), ring_(cap, PtrAllocator(alloc)), stamps_(cap, StampAllocator(alloc)),
+      trace_stamps_(TraceAllocator(alloc)), max_age_ms_(max_age_ms),
+      sampling_mode_(SamplingMode::kNone), max_push_rate_(0), decimation_(0),
+      decimate_every_(1), is_overloaded_(false), rate_start_ms_(0), rate_pushes_(0),
+      sample_seen_(0), sample_kept_(0), reservoir_w_(0.0), reservoir_next_(0),
+      drain_timer_(0), drain_timer_generation_(0), has_drain_deadline_(false), is_stopped_(false),
+      is_stopping_(false)
   {
     ClearInternal();
   }
 
-  ~LatestFixedQueue() {}
+  ~LatestFixedQueue()
+  {
+    // every StopAsync timer that may still call into the queue, including
+    // superseded ones already running, is dropped or waited for; with no
+    // current timer left the callbacks return without scheduling more
+    while (true) {
+      std::map<uint64_t, uint64_t> timers;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        drain_timer_ = 0;
+        timers = drain_timers_;
+      }
+      if (timers.empty()) {
+        break;
+      }
+      for (const auto& timer : timers) {
+        if (DeadlineTimer::Instance().Cancel(timer.second, true)) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          drain_timers_.erase(timer.first);
+        }
+      }
+    }
+  }
 
   bool IsFull() const
   {
@@ -28,47 +82,82 @@ public:
     return size_ <= 0;
   }
 
-  void Push(const std::shared_ptr<DataType>& data_ptr)
+  PushStatus Push(const std::shared_ptr<DataType>& data_ptr)
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (is_stopping_.load() || is_stopped_) {
-      printf("LatestFixedQueue is stopped, push nothing\n");
-      return;
+    if (is_stopped_) {
+      return PushStatus::kStopped;
+    }
+    if (is_stopping_.load()) {
+      return PushStatus::kStopping;
+    }
+    int64_t now = 0;
+    if (max_age_ms_ > 0) {
+      now = CoarseNowMs();
+      ExpireInternal(now);
     }
-    if (IsFull()) {
-      static auto last = std::chrono::steady_clock::now();
-      auto elspsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::steady_clock::now() - last);
-      if (elspsed.count() > 1000) {
-        last = std::chrono::steady_clock::now();
-        printf("queue is full, remove the oldest data");
+    if (sampling_mode_ != SamplingMode::kNone && !SampleInternal()) {
+      return PushStatus::kSampledOut;
+    }
+    if (is_overloaded_ && sampling_mode_ == SamplingMode::kReservoir && size_ >= ReservoirCap()) {
+      PunchRandomHoleInternal();
+    }
+    if (span_ >= cap_) {
+      if (size_ < span_) {
+        CompactInternal();
+      } else {
+        static auto last = std::chrono::steady_clock::now();
+        auto elspsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - last);
+        if (elspsed.count() > 1000) {
+          last = std::chrono::steady_clock::now();
+          printf("queue is full, remove the oldest data");
+        }
+        DropFrontInternal();
       }
-      ring_[front_] = nullptr;
-      front_ = (front_ + 1) % cap_;
-    } else {
-      size_++;
     }
+    size_++;
+    span_++;
     rear_ = (rear_ + 1) % cap_;
 
     ring_[rear_] = data_ptr;
+    stamps_[rear_] = now;
+    if (tracer_) {
+      trace_stamps_[rear_] = tracer_->Now();
+    }
+    if (watermark_) {
+      watermark_->Update(size_);
+    }
     cv_.notify_one();
+    return PushStatus::kOk;
   }
 
   bool Pop(std::shared_ptr<DataType>& data_ptr)
   {
     std::unique_lock<std::mutex> lock(mutex_);
-    cv_.wait(lock, [this] { return is_stopped_ || !IsEmpty(); });
+    cv_.wait(lock, [this] {
+      if (max_age_ms_ > 0) {
+        ExpireInternal(CoarseNowMs());
+      }
+      return is_stopped_ || !IsEmpty();
+    });
 
     if (is_stopped_) {
       printf("LatestFixedQueue is stopped, pop nothing\n");
       return false;
     }
 
-    size_--;
-
     data_ptr = ring_[front_];
-    ring_[front_] = nullptr;
-    front_ = (front_ + 1) % cap_;
+    if (tracer_) {
+      tracer_->RecordSojourn(trace_stamps_[front_]);
+    }
+    DropFrontInternal();
+    if (watermark_) {
+      watermark_->Update(size_);
+    }
+    if (size_ == 0) {
+      NotifyDrainedInternal();
+    }
     return true;
   }
 
@@ -77,36 +166,63 @@ public:
     return size_;
   }
 
-  void GetItems(
-      std::vector<DataType>& data_arr,
-      std::function<bool(const std::shared_ptr<DataType>& data_ptr)> filter =
-          [](const std::shared_ptr<DataType>& data_ptr) {
-            (void)data_ptr;
-            return true;
-          },
-      int maxCount = 0)
+  void GetItems(std::vector<DataType>& data_arr)
+  {
+    GetItems(data_arr, AcceptAll());
+  }
+
+  // Copies the payloads accepted by filter(const std::shared_ptr<DataType>&),
+  // oldest first, at most maxCount if maxCount > 0. data_arr is cleared first
+  // unless append is set, so a buffer reused across polls keeps its capacity.
+  template <typename Filter>
+  void GetItems(std::vector<DataType>& data_arr, Filter&& filter,
+                int maxCount = 0, bool append = false)
   {
-    data_arr.clear();
+    if (!append) {
+      data_arr.clear();
+    }
     std::lock_guard<std::mutex> lock(mutex_);
-    if (IsEmpty()) {
-      return;
-    } else {
-      int count = 0;
-      if (maxCount <= 0 || maxCount > Size()) {
-        maxCount = Size();
-      }
-      int i = front_;
-      int j = 0;
-      while (count < maxCount && j < Size()) {
-        if (filter(ring_[i])) {
-          data_arr.emplace_back(*ring_[i]);
-          count++;
-        }
-        i++;
-        i = i % cap_;
-        j++;
+    VisitInternal(filter, maxCount, [&data_arr](const std::shared_ptr<DataType>& data_ptr) {
+      data_arr.emplace_back(*data_ptr);
+    });
+  }
+
+  // Same as GetItems, but shares the payloads instead of copying them.
+  template <typename Filter>
+  void GetItemPtrs(std::vector<std::shared_ptr<DataType>>& ptr_arr, Filter&& filter,
+                   int maxCount = 0, bool append = false)
+  {
+    if (!append) {
+      ptr_arr.clear();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    VisitInternal(filter, maxCount, [&ptr_arr](const std::shared_ptr<DataType>& data_ptr) {
+      ptr_arr.emplace_back(data_ptr);
+    });
+  }
+
+  // Visits the payloads in place, oldest first, without copying them. The
+  // visitor is called as bool visitor(const DataType&) and stops the walk by
+  // returning false. It runs under the queue lock, so it must not call back
+  // into the queue. Returns the number of payloads visited.
+  template <typename Visitor>
+  int ForEach(Visitor&& visitor)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (max_age_ms_ > 0) {
+      ExpireInternal(CoarseNowMs());
+    }
+    int count = 0;
+    for (int i = 0, j = front_; i < span_; i++, j = (j + 1) % cap_) {
+      if (!ring_[j]) {
+        continue;  // hole, see PunchRandomHoleInternal
+      }
+      count++;
+      if (!visitor(static_cast<const DataType&>(*ring_[j]))) {
+        break;
       }
     }
+    return count;
   }
 
   bool Start()
@@ -122,46 +238,76 @@ public:
     return true;
   }
 
-  void Stop(bool after_queue_empty = false, int max_wait_ms = 0)
+  // Without after_queue_empty, stops at once and drops the entries.
+  // Otherwise Push is rejected with kStopping while consumers drain the
+  // queue, and Stop returns as soon as the last entry is popped or, if
+  // max_wait_ms > 0, at that deadline. Returns false if the queue was
+  // stopped before it drained.
+  bool Stop(bool after_queue_empty = false, int max_wait_ms = 0)
   {
+    std::unique_lock<std::mutex> lock(mutex_);
     if (!after_queue_empty) {
-      std::lock_guard<std::mutex> lock(mutex_);
-      is_stopped_ = true;
+      FinishStopInternal(false);
       ClearInternal();
-      cv_.notify_all();
-      return;
+      return true;
     }
 
-    auto start_time = std::chrono::steady_clock::now();
-    while (true) {
-      is_stopping_.store(true);
-      {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (IsEmpty()) {
-          is_stopped_ = true;
-          is_stopping_.store(false);
-          cv_.notify_all();
-          break;
-        }
-        cv_.notify_all();
-        printf("Waiting for queue empty, queue _size=%d\n", Size());
-      }
-      
-      if (max_wait_ms > 0) {
-        auto current_time = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - start_time).count();
-        if (elapsed >= max_wait_ms) {
-          printf("Stop timeout after %d ms, force stop\n", max_wait_ms);
-          std::lock_guard<std::mutex> lock(mutex_);
-          is_stopped_ = true;
-          is_stopping_.store(false);
-          cv_.notify_all();
-          break;
-        }
+    is_stopping_.store(true);
+    cv_.notify_all();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_wait_ms);
+    bool drained = true;
+    while (!DrainedInternal()) {
+      if (max_age_ms_ > 0) {
+        // nothing signals when the front entry ages out, so wake up for it
+        auto expiry = std::chrono::steady_clock::now() +
+                      std::chrono::milliseconds(stamps_[front_] + max_age_ms_ - CoarseNowMs() + 1);
+        drained_cv_.wait_until(lock, max_wait_ms > 0 && deadline < expiry ? deadline : expiry);
+      } else if (max_wait_ms > 0) {
+        drained_cv_.wait_until(lock, deadline);
+      } else {
+        drained_cv_.wait(lock);
+      }
+      if (max_wait_ms > 0 && std::chrono::steady_clock::now() >= deadline) {
+        drained = DrainedInternal();
+        break;
+      }
+    }
+    FinishStopInternal(drained);
+    return drained;
+  }
+
+  // Non-blocking Stop: the returned future gets Stop's result. It is
+  // fulfilled by the consumer that empties the queue, or by the shared
+  // DeadlineTimer at max_wait_ms, so draining many queues in parallel costs
+  // no thread per queue.
+  std::future<bool> StopAsync(bool after_queue_empty = true, int max_wait_ms = 0)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!after_queue_empty) {
+      FinishStopInternal(false);
+      ClearInternal();
+      std::promise<bool> stopped;
+      stopped.set_value(true);
+      return stopped.get_future();
+    }
+
+    drain_promises_.emplace_back();
+    std::future<bool> result = drain_promises_.back().get_future();
+    is_stopping_.store(true);
+    cv_.notify_all();
+    if (max_wait_ms > 0) {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_wait_ms);
+      if (!has_drain_deadline_ || deadline < drain_deadline_) {
+        drain_deadline_ = deadline;
       }
-      
-      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      has_drain_deadline_ = true;
     }
+    if (DrainedInternal()) {
+      FinishStopInternal(true);
+    } else {
+      ScheduleDrainTimerInternal();
+    }
+    return result;
   }
 
   void SetCapacity(int cap)
@@ -169,6 +315,101 @@ public:
     std::lock_guard<std::mutex> lock(mutex_);
     cap_ = cap;
     ring_.resize(cap);
+    stamps_.resize(cap);
+    if (tracer_) {
+      trace_stamps_.resize(cap);
+    }
+  }
+
+  // Opt-in sojourn-time tracing: Push stamps each slot in an array parallel
+  // to the ring and Pop reports the stamp to tracer. Entries evicted before
+  // being popped are not recorded. nullptr turns tracing off.
+  void SetTracer(const std::shared_ptr<QueueTracer>& tracer)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tracer_ = tracer;
+    trace_stamps_.assign(tracer_ ? cap_ : 0, 0);
+  }
+
+  // Edge-triggered backpressure: the watermark sees the size after every
+  // change. Since Push evicts instead of failing, this is how producers learn
+  // to slow down before data is lost. nullptr turns it off.
+  void SetWatermark(const std::shared_ptr<Watermark>& watermark)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    watermark_ = watermark;
+    if (watermark_) {
+      watermark_->Update(size_);
+    }
+  }
+
+  // Entries older than max_age_ms are skipped and lazily reclaimed from the
+  // front on Push, Pop and GetItems. 0 disables the age limit.
+  void SetMaxAge(int max_age_ms)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (max_age_ms > 0 && max_age_ms_ <= 0) {
+      // entries pushed without an age limit carry no timestamp yet
+      int64_t now = CoarseNowMs();
+      for (int i = 0, j = front_; i < span_; i++, j = (j + 1) % cap_) {
+        stamps_[j] = now;
+      }
+    }
+    max_age_ms_ = max_age_ms;
+  }
+
+  int MaxAge() const
+  {
+    return max_age_ms_;
+  }
+
+  // Overload mode: once more than max_push_rate pushes per second arrive
+  // (measured over kRateWindowMs), pushes are sampled instead of the queue
+  // degenerating to the latest burst, and Push returns kSampledOut for the
+  // dropped ones. kReservoir keeps a uniform sample of cap / 2 of the
+  // pushes since the overload began (Algorithm L: rejected pushes only
+  // advance a skip count), restarting whenever consumers empty the queue;
+  // replaced entries leave holes, so entries must not be null. kDecimate
+  // keeps every decimation-th push, or rate / max_push_rate if decimation
+  // is 0.
+  void SetSampling(SamplingMode mode, int max_push_rate, int decimation = 0)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sampling_mode_ = max_push_rate > 0 ? mode : SamplingMode::kNone;
+    max_push_rate_ = max_push_rate;
+    decimation_ = decimation;
+    is_overloaded_ = false;
+    rate_start_ms_ = CoarseNowMs();
+    rate_pushes_ = 0;
+  }
+
+  bool IsSampling()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sampling_mode_ != SamplingMode::kNone) {
+      UpdateRateInternal(CoarseNowMs());
+    }
+    return is_overloaded_;
+  }
+
+  // Held entries per push since the overload began, 1.0 when not sampling.
+  // Each popped entry stands for 1 / SamplingRatio() pushes. kDecimate
+  // counts the kept pushes; kReservoir counts the sample it holds, since
+  // entries kept earlier were replaced.
+  double SamplingRatio()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sampling_mode_ != SamplingMode::kNone) {
+      UpdateRateInternal(CoarseNowMs());
+    }
+    if (!is_overloaded_ || sample_seen_ == 0) {
+      return 1.0;
+    }
+    if (sampling_mode_ == SamplingMode::kReservoir) {
+      int held = std::min<int>(size_, ReservoirCap());
+      return held > 0 ? static_cast<double>(held) / sample_seen_ : 1.0;
+    }
+    return static_cast<double>(sample_kept_) / sample_seen_;
   }
   
   void Clear()
@@ -178,24 +419,384 @@ public:
   }
 
 private:
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<std::shared_ptr<DataType>> PtrAllocator;
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<int64_t> StampAllocator;
+  typedef typename std::allocator_traits<Allocator>::template rebind_alloc<uint64_t> TraceAllocator;
+
+  struct AcceptAll
+  {
+    bool operator()(const std::shared_ptr<DataType>& data_ptr) const
+    {
+      (void)data_ptr;
+      return true;
+    }
+  };
+
+  // Caller holds mutex_. Hands every entry accepted by filter to sink.
+  template <typename Filter, typename Sink>
+  void VisitInternal(Filter& filter, int maxCount, Sink sink)
+  {
+    if (max_age_ms_ > 0) {
+      ExpireInternal(CoarseNowMs());
+    }
+    if (maxCount <= 0 || maxCount > size_) {
+      maxCount = size_;
+    }
+    int count = 0;
+    for (int i = 0, j = front_; count < maxCount && i < span_; i++, j = (j + 1) % cap_) {
+      if (ring_[j] && filter(static_cast<const std::shared_ptr<DataType>&>(ring_[j]))) {
+        sink(ring_[j]);
+        count++;
+      }
+    }
+  }
+
+  // Monotonic milliseconds from the coarse clock, cheap enough to stamp
+  // every push.
+  static int64_t CoarseNowMs()
+  {
+#ifdef CLOCK_MONOTONIC_COARSE
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+#else
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  // Stamps never decrease from front to rear, so the first entry inside the
+  // time window is found with a binary search. Returns its offset from front_.
+  // Holes keep the stamp of the entry they replaced.
+  int WindowStart(int64_t now) const
+  {
+    int64_t oldest = now - max_age_ms_;
+    int lo = 0;
+    int hi = span_;
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (stamps_[(front_ + mid) % cap_] < oldest) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  void ExpireInternal(int64_t now)
+  {
+    int expired = 0;
+    for (int i = WindowStart(now); i > 0; i--) {
+      if (ring_[front_]) {
+        ring_[front_] = nullptr;
+        expired++;
+      }
+      front_ = (front_ + 1) % cap_;
+      span_--;
+    }
+    size_ -= expired;
+    SkipHolesInternal();
+    if (expired > 0 && watermark_) {
+      watermark_->Update(size_);
+    }
+    if (expired > 0 && size_ == 0) {
+      NotifyDrainedInternal();
+    }
+  }
+
+  // Caller holds mutex_. Tracks the push rate and returns false if this push
+  // is dropped by the sampling.
+  bool SampleInternal()
+  {
+    UpdateRateInternal(CoarseNowMs());
+    rate_pushes_++;
+    if (!is_overloaded_) {
+      return true;
+    }
+
+    if (size_ == 0) {
+      StartSampleInternal();  // consumers caught up
+    }
+    sample_seen_++;
+    bool keep = false;
+    if (sampling_mode_ == SamplingMode::kDecimate) {
+      keep = (sample_seen_ - 1) % decimate_every_ == 0;
+    } else if (reservoir_next_ == 0) {
+      // filling the reservoir: the queue is the sample
+      keep = true;
+      if (size_ + 1 >= ReservoirCap()) {
+        reservoir_w_ = std::exp(std::log(RandomUnit()) / ReservoirCap());
+        reservoir_next_ = sample_seen_ + ReservoirSkip();
+      }
+    } else if (sample_seen_ == reservoir_next_) {
+      keep = true;
+      reservoir_w_ *= std::exp(std::log(RandomUnit()) / ReservoirCap());
+      reservoir_next_ += ReservoirSkip();
+    }
+    if (keep) {
+      sample_kept_++;
+    }
+    return keep;
+  }
+
+  // Caller holds mutex_. Re-evaluates the overload once per kRateWindowMs,
+  // from Push or from the accessors when producers went quiet.
+  void UpdateRateInternal(int64_t now)
+  {
+    if (now - rate_start_ms_ < kRateWindowMs) {
+      return;
+    }
+    // nothing closed the window for a whole window past its end, so nothing
+    // was pushed then: that quiet window is the latest rate
+    int64_t elapsed = now - rate_start_ms_;
+    int64_t rate = elapsed >= 2 * kRateWindowMs ? 0 : rate_pushes_ * 1000 / elapsed;
+    bool is_overloaded = rate > max_push_rate_;
+    if (is_overloaded && !is_overloaded_) {
+      StartSampleInternal();
+    }
+    is_overloaded_ = is_overloaded;
+    if (is_overloaded) {
+      decimate_every_ = decimation_ > 0 ? decimation_ : (rate + max_push_rate_ - 1) / max_push_rate_;
+    }
+    rate_start_ms_ = now;
+    rate_pushes_ = 0;
+  }
+
+  void StartSampleInternal()
+  {
+    sample_seen_ = 0;
+    sample_kept_ = 0;
+    reservoir_next_ = 0;
+    if (sampling_mode_ == SamplingMode::kReservoir) {
+      while (size_ > ReservoirCap()) {
+        DropFrontInternal();
+      }
+    }
+  }
+
+  // The reservoir holds half the capacity; the other half takes the holes
+  // left by replaced entries.
+  int ReservoirCap() const
+  {
+    return cap_ > 1 ? cap_ / 2 : 1;
+  }
+
+  // Algorithm L: number of pushes until the next one enters the reservoir.
+  int64_t ReservoirSkip()
+  {
+    return static_cast<int64_t>(std::floor(std::log(RandomUnit()) / std::log(1.0 - reservoir_w_))) + 1;
+  }
+
+  // Uniform in (0, 1).
+  double RandomUnit()
+  {
+    return (static_cast<double>(rng_()) + 1.0) / (static_cast<double>(rng_.max()) + 2.0);
+  }
+
+  // Caller holds mutex_ and size_ > 0. Removes the front entry and the holes
+  // behind it.
+  void DropFrontInternal()
+  {
+    ring_[front_] = nullptr;
+    front_ = (front_ + 1) % cap_;
+    span_--;
+    size_--;
+    SkipHolesInternal();
+  }
+
+  // Keeps the front slot an entry, so Pop and max-age eviction need not
+  // look for one.
+  void SkipHolesInternal()
+  {
+    while (span_ > size_ && !ring_[front_]) {
+      front_ = (front_ + 1) % cap_;
+      span_--;
+    }
+  }
+
+  // Caller holds mutex_ and size_ > 0. Reservoir replacement in O(1): a
+  // uniformly chosen entry becomes a hole (an empty slot that reads skip),
+  // so order and stamps stay sorted without moving anything. At most half
+  // the slots are holes, so the expected number of draws is at most two.
+  void PunchRandomHoleInternal()
+  {
+    int j = 0;
+    do {
+      j = (front_ + static_cast<int>(rng_() % span_)) % cap_;
+    } while (!ring_[j]);
+    ring_[j] = nullptr;
+    size_--;
+    SkipHolesInternal();
+  }
+
+  // Caller holds mutex_. Closes the holes in one pass, keeping the order.
+  // Only needed once the ring is full of entries and holes, i.e. once every
+  // cap - ReservoirCap() replacements, so O(1) amortized.
+  void CompactInternal()
+  {
+    int to = front_;
+    for (int i = 0, from = front_; i < span_; i++, from = (from + 1) % cap_) {
+      if (!ring_[from]) {
+        continue;
+      }
+      if (from != to) {
+        ring_[to] = std::move(ring_[from]);
+        stamps_[to] = stamps_[from];
+        if (tracer_) {
+          trace_stamps_[to] = trace_stamps_[from];
+        }
+      }
+      to = (to + 1) % cap_;
+    }
+    span_ = size_;
+    rear_ = (front_ + span_ - 1 + cap_) % cap_;
+  }
+
+  // Caller holds mutex_ and the queue just became empty.
+  void NotifyDrainedInternal()
+  {
+    if (!is_stopping_.load()) {
+      return;
+    }
+    drained_cv_.notify_all();
+    if (!drain_promises_.empty()) {
+      FinishStopInternal(true);
+    }
+  }
+
+  // Caller holds mutex_. Completes Stop and StopAsync with drained.
+  void FinishStopInternal(bool drained)
+  {
+    is_stopped_ = true;
+    is_stopping_.store(false);
+    cv_.notify_all();
+    drained_cv_.notify_all();
+    for (auto& promise : drain_promises_) {
+      promise.set_value(drained);
+    }
+    drain_promises_.clear();
+    has_drain_deadline_ = false;
+    CancelDrainTimerInternal();
+  }
+
+  // Caller holds mutex_. Stops tracking the current timer. It is dropped
+  // unless it already runs, in which case its callback finds itself stale.
+  void CancelDrainTimerInternal()
+  {
+    if (drain_timer_ == 0) {
+      return;
+    }
+    // no wait, the callback takes mutex_
+    if (DeadlineTimer::Instance().Cancel(drain_timers_[drain_timer_])) {
+      drain_timers_.erase(drain_timer_);
+    }
+    drain_timer_ = 0;
+  }
+
+  // Caller holds mutex_. Wakes up at the StopAsync deadline or, with a max
+  // age, when the front entry ages out, since nothing else signals either.
+  void ScheduleDrainTimerInternal()
+  {
+    CancelDrainTimerInternal();
+    bool has_wake = has_drain_deadline_;
+    auto wake = drain_deadline_;
+    if (max_age_ms_ > 0 && size_ > 0) {
+      auto expiry = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(stamps_[front_] + max_age_ms_ - CoarseNowMs() + 1);
+      if (!has_wake || expiry < wake) {
+        wake = expiry;
+      }
+      has_wake = true;
+    }
+    if (has_wake) {
+      // the callback cannot run before the id is stored, it takes mutex_
+      uint64_t generation = ++drain_timer_generation_;
+      drain_timers_[generation] = DeadlineTimer::Instance().Schedule(
+          wake, [this, generation] { OnDrainTimer(generation); });
+      drain_timer_ = generation;
+    }
+  }
+
+  void OnDrainTimer(uint64_t generation)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drain_timers_.erase(generation);
+    if (generation != drain_timer_) {
+      return;  // superseded or cancelled after it started running
+    }
+    drain_timer_ = 0;
+    if (drain_promises_.empty()) {
+      return;
+    }
+    if (DrainedInternal()) {
+      FinishStopInternal(true);
+    } else if (has_drain_deadline_ && std::chrono::steady_clock::now() >= drain_deadline_) {
+      FinishStopInternal(false);
+    } else {
+      ScheduleDrainTimerInternal();
+    }
+  }
+
+  // Caller holds mutex_.
+  bool DrainedInternal()
+  {
+    if (max_age_ms_ > 0) {
+      ExpireInternal(CoarseNowMs());
+    }
+    return is_stopped_ || IsEmpty();
+  }
+
   void ClearInternal()
   {
     size_ = 0;
+    span_ = 0;
     front_ = 0;
     rear_ = -1;
     for (auto& data_ptr : ring_) {
       data_ptr = nullptr;
     }
+    if (watermark_) {
+      watermark_->Update(0);
+    }
+    NotifyDrainedInternal();
   }
 
 private:
+  static const int kRateWindowMs = 100;
+
   std::atomic<int> size_;
   int cap_;
+  int span_;  // slots in use from front_, holes included
   int front_;
   int rear_;
-  std::vector<std::shared_ptr<DataType>> ring_;
+  std::vector<std::shared_ptr<DataType>, PtrAllocator> ring_;
+  std::vector<int64_t, StampAllocator> stamps_;  // push time of each slot, if max_age_ms_ > 0
+  std::shared_ptr<QueueTracer> tracer_;
+  std::vector<uint64_t, TraceAllocator> trace_stamps_;  // tracer_ stamp of each slot
+  std::shared_ptr<Watermark> watermark_;
+  int max_age_ms_;
+  SamplingMode sampling_mode_;
+  int max_push_rate_;
+  int decimation_;
+  int64_t decimate_every_;
+  bool is_overloaded_;
+  int64_t rate_start_ms_;
+  int64_t rate_pushes_;  // pushes since rate_start_ms_
+  int64_t sample_seen_;  // pushes since the overload or the sample began
+  int64_t sample_kept_;
+  double reservoir_w_;
+  int64_t reservoir_next_;  // sample_seen_ of the next push to keep, 0 while filling
+  std::mt19937 rng_;
   std::mutex mutex_;
   std::condition_variable cv_;
+  std::condition_variable drained_cv_;  // signalled when the queue empties while stopping
+  std::vector<std::promise<bool>> drain_promises_;  // pending StopAsync results
+  uint64_t drain_timer_;  // generation of the current timer, 0 if none
+  uint64_t drain_timer_generation_;
+  std::map<uint64_t, uint64_t> drain_timers_;  // generation -> DeadlineTimer id, until its callback runs
+  bool has_drain_deadline_;
+  std::chrono::steady_clock::time_point drain_deadline_;
   bool is_stopped_;
   std::atomic<bool> is_stopping_;
 };
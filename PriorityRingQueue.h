@@ -0,0 +1,189 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Bounded priority work queue for small integer priority ranges.
+//
+// Every priority level owns a fixed ring, and a bitmap tracks which levels are
+// non-empty, so Push and Pop are O(1): Pop finds the most urgent level with a
+// find-first-set on the bitmap. Level 0 is the most urgent one; items of the
+// same level are popped in strict FIFO order.
+template <typename DataType>
+class PriorityRingQueue {
+public:
+  static const int kMaxLevels = 64;
+
+  // levels is clamped to [1, kMaxLevels]; check Levels() for the actual
+  // count, since Push rejects any level at or above it. cap is the capacity
+  // of each level.
+  PriorityRingQueue(int levels, int cap)
+    : levels_(levels < 1 ? 1 : (levels > kMaxLevels ? kMaxLevels : levels)),
+      cap_(cap), rings_(levels_), non_empty_(0), size_(0), waiting_producers_(0)
+  {
+    for (auto& ring : rings_) {
+      ring.slots.resize(cap_);
+      ring.front = 0;
+      ring.size = 0;
+    }
+  }
+
+  ~PriorityRingQueue() {}
+
+  int Levels() const
+  {
+    return levels_;
+  }
+
+  int Size() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  bool IsEmpty() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return non_empty_ == 0;
+  }
+
+  bool IsFull(int level) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return level < 0 || level >= levels_ || rings_[level].size >= cap_;
+  }
+
+  // Returns false if level is out of range, or if the level is full and
+  // forever is not set. With forever set, waits until the level has room.
+  bool Push(const DataType& data, int level, bool forever = false)
+  {
+    if (level < 0 || level >= levels_) {
+      return false;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    Ring& ring = rings_[level];
+    if (ring.size >= cap_) {
+      if (!forever) {
+        return false;
+      }
+      waiting_producers_++;
+      not_full_.wait(lock, [this, &ring] { return ring.size < cap_; });
+      waiting_producers_--;
+    }
+
+    ring.slots[(ring.front + ring.size) % cap_] = data;
+    ring.size++;
+    size_++;
+    non_empty_ |= (uint64_t(1) << level);
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Pops the oldest item of the most urgent non-empty level.
+  // msecs == 0: return immediately, msecs < 0: wait forever,
+  // msecs > 0: wait at most msecs milliseconds.
+  bool Pop(DataType& data, long msecs = 0, int* level = nullptr)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (non_empty_ == 0) {
+      if (msecs == 0) {
+        return false;
+      } else if (msecs < 0) {
+        not_empty_.wait(lock, [this] { return non_empty_ != 0; });
+      } else if (!not_empty_.wait_for(lock, std::chrono::milliseconds(msecs),
+                                      [this] { return non_empty_ != 0; })) {
+        return false;
+      }
+    }
+
+    int first = FindFirstSet(non_empty_);
+    PopLevel(first, data);
+    if (level) {
+      *level = first;
+    }
+    return true;
+  }
+
+  // Appends all items in priority order, FIFO within a level.
+  void PopAll(std::vector<DataType>& data_arr)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_arr.reserve(data_arr.size() + size_);
+    while (non_empty_ != 0) {
+      int first = FindFirstSet(non_empty_);
+      DataType data;
+      PopLevel(first, data);
+      data_arr.emplace_back(std::move(data));
+    }
+  }
+
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& ring : rings_) {
+      for (auto& slot : ring.slots) {
+        slot = DataType();
+      }
+      ring.front = 0;
+      ring.size = 0;
+    }
+    non_empty_ = 0;
+    size_ = 0;
+    if (waiting_producers_ > 0) {
+      not_full_.notify_all();
+    }
+  }
+
+private:
+  struct Ring
+  {
+    std::vector<DataType> slots;
+    int front;
+    int size;
+  };
+
+  static int FindFirstSet(uint64_t bits)
+  {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int n = 0;
+    while (!(bits & 1)) {
+      bits >>= 1;
+      n++;
+    }
+    return n;
+#endif
+  }
+
+  // Caller holds mutex_ and guarantees the level is non-empty.
+  void PopLevel(int level, DataType& data)
+  {
+    Ring& ring = rings_[level];
+    data = std::move(ring.slots[ring.front]);
+    ring.slots[ring.front] = DataType();
+    ring.front = (ring.front + 1) % cap_;
+    ring.size--;
+    size_--;
+    if (ring.size == 0) {
+      non_empty_ &= ~(uint64_t(1) << level);
+    }
+    if (waiting_producers_ > 0) {
+      not_full_.notify_all();
+    }
+  }
+
+private:
+  int levels_;
+  int cap_;
+  std::vector<Ring> rings_;
+  uint64_t non_empty_;
+  int size_;
+  int waiting_producers_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// HDR-style latency histogram: values are split into power-of-two ranges,
+// each divided into 2^kSubBits linear sub-buckets, so every recorded value
+// keeps a relative error below 1/2^kSubBits over the whole uint64_t range.
+// Record is lock-free and may be called from several threads.
+class LatencyHistogram {
+public:
+  static const int kSubBits = 5;
+  static const int kSubBuckets = 1 << kSubBits;
+  static const int kBuckets = (65 - kSubBits) * kSubBuckets;
+
+  LatencyHistogram()
+  {
+    Reset();
+  }
+
+  void Record(uint64_t value)
+  {
+    counts_[Index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t Count() const
+  {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t Max() const
+  {
+    return max_.load(std::memory_order_relaxed);
+  }
+
+  double Mean() const
+  {
+    uint64_t count = Count();
+    return count ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / count : 0.0;
+  }
+
+  // Upper bound of the bucket holding the given percentile (0-100).
+  uint64_t Percentile(double percentile) const
+  {
+    uint64_t count = Count();
+    if (count == 0) {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+    if (rank < 1) {
+      rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+        uint64_t upper = UpperBound(i);
+        return upper < Max() ? upper : Max();
+      }
+    }
+    return Max();
+  }
+
+  void Reset()
+  {
+    for (int i = 0; i < kBuckets; i++) {
+      counts_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  static int Index(uint64_t value)
+  {
+    if (value < static_cast<uint64_t>(kSubBuckets)) {
+      return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBits;
+    return ((shift + 1) << kSubBits) + static_cast<int>((value >> shift) & (kSubBuckets - 1));
+  }
+
+  static uint64_t UpperBound(int index)
+  {
+    if (index < kSubBuckets) {
+      return index;
+    }
+    int shift = (index >> kSubBits) - 1;
+    uint64_t lower = static_cast<uint64_t>((index & (kSubBuckets - 1)) + kSubBuckets) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+  }
+
+  std::atomic<uint64_t> counts_[kBuckets];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+};
+
+// Per-queue sojourn-time tracer. A traced queue stamps every slot with Now()
+// on push, in an array parallel to the payloads, and calls RecordSojourn with
+// that stamp on pop. Every sample_every-th pop goes into the latency
+// histogram (in nanoseconds) and, if max_events > 0, into a bounded timeline
+// of the latest events that WriteChromeTrace exports for chrome://tracing or
+// Perfetto. Several queues of a pipeline can be exported into one trace to
+// see where latency accumulates.
+class QueueTracer {
+public:
+  enum Clock {
+    kMonotonic,  // CLOCK_MONOTONIC
+    kCoarse,     // CLOCK_MONOTONIC_COARSE, cheapest, a few ms resolution
+    kTsc,        // rdtsc calibrated against CLOCK_MONOTONIC, x86 only
+  };
+
+  explicit QueueTracer(const std::string& name, int sample_every = 1,
+                       size_t max_events = 0, Clock clock = kMonotonic)
+    : name_(name), sample_every_(sample_every < 1 ? 1 : sample_every),
+      max_events_(max_events), clock_(clock), pops_(0), next_event_(0),
+      base_ticks_(0), base_ns_(0), ns_per_tick_(1.0)
+  {
+#if !defined(__x86_64__) && !defined(__i386__)
+    if (clock_ == kTsc) {
+      clock_ = kMonotonic;
+    }
+#endif
+    if (clock_ == kTsc) {
+      Calibrate();
+    }
+  }
+
+  const std::string& Name() const
+  {
+    return name_;
+  }
+
+  // Raw timestamp to store in the queue on push.
+  uint64_t Now() const
+  {
+    switch (clock_) {
+#if defined(__x86_64__) || defined(__i386__)
+      case kTsc: return __rdtsc();
+#endif
+#ifdef CLOCK_MONOTONIC_COARSE
+      case kCoarse: return ClockNs(CLOCK_MONOTONIC_COARSE);
+#endif
+      default: return ClockNs(CLOCK_MONOTONIC);
+    }
+  }
+
+  // Called on pop with the stamp taken on push.
+  void RecordSojourn(uint64_t enqueue_stamp)
+  {
+    if (pops_.fetch_add(1, std::memory_order_relaxed) % sample_every_ != 0) {
+      return;
+    }
+    uint64_t enqueue_ns = ToNs(enqueue_stamp);
+    uint64_t dequeue_ns = ToNs(Now());
+    histogram_.Record(dequeue_ns > enqueue_ns ? dequeue_ns - enqueue_ns : 0);
+
+    if (max_events_ > 0) {
+      std::lock_guard<std::mutex> lock(events_mutex_);
+      Event event = {enqueue_ns, dequeue_ns > enqueue_ns ? dequeue_ns : enqueue_ns};
+      if (events_.size() < max_events_) {
+        events_.push_back(event);
+      } else {
+        events_[next_event_ % max_events_] = event;
+      }
+      next_event_++;
+    }
+  }
+
+  const LatencyHistogram& Histogram() const
+  {
+    return histogram_;
+  }
+
+  void Reset()
+  {
+    histogram_.Reset();
+    pops_.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    events_.clear();
+    next_event_ = 0;
+  }
+
+  void WriteChromeTrace(std::ostream& os) const
+  {
+    WriteChromeTrace(os, std::vector<const QueueTracer*>(1, this));
+  }
+
+  // Chrome trace event format: one track per queue, one complete ("X")
+  // event per sampled item spanning its push and pop.
+  static void WriteChromeTrace(std::ostream& os, const std::vector<const QueueTracer*>& tracers)
+  {
+    os << "{\"traceEvents\":[";
+    bool first = true;
+    for (size_t tid = 0; tid < tracers.size(); tid++) {
+      const QueueTracer* tracer = tracers[tid];
+      os << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << tid << ",\"args\":{\"name\":\"";
+      WriteEscaped(os, tracer->name_);
+      os << "\"}}";
+      first = false;
+
+      std::lock_guard<std::mutex> lock(tracer->events_mutex_);
+      size_t n = tracer->events_.size();
+      size_t start = n == 0 || n < tracer->max_events_ ? 0 : tracer->next_event_ % n;
+      for (size_t i = 0; i < n; i++) {
+        const Event& event = tracer->events_[(start + i) % n];
+        os << ",\n{\"name\":\"";
+        WriteEscaped(os, tracer->name_);
+        os << "\",\"cat\":\"sojourn\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"ts\":";
+        WriteMicros(os, event.enqueue_ns);
+        os << ",\"dur\":";
+        WriteMicros(os, event.dequeue_ns - event.enqueue_ns);
+        os << "}";
+      }
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  }
+
+private:
+  struct Event
+  {
+    uint64_t enqueue_ns;
+    uint64_t dequeue_ns;
+  };
+
+  static uint64_t ClockNs(clockid_t clock)
+  {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+  }
+
+  // Maps raw stamps onto CLOCK_MONOTONIC nanoseconds, so tracers with
+  // different clocks share one timeline.
+  uint64_t ToNs(uint64_t stamp) const
+  {
+    if (clock_ != kTsc) {
+      return stamp;
+    }
+    int64_t delta = static_cast<int64_t>(stamp - base_ticks_);
+    return base_ns_ + static_cast<int64_t>(delta * ns_per_tick_);
+  }
+
+  void Calibrate()
+  {
+    uint64_t ns0 = ClockNs(CLOCK_MONOTONIC);
+    uint64_t ticks0 = Now();
+    uint64_t ns1 = ns0;
+    while (ns1 - ns0 < 2000000) {
+      ns1 = ClockNs(CLOCK_MONOTONIC);
+    }
+    uint64_t ticks1 = Now();
+    base_ticks_ = ticks0;
+    base_ns_ = ns0;
+    ns_per_tick_ = ticks1 > ticks0 ? static_cast<double>(ns1 - ns0) / (ticks1 - ticks0) : 1.0;
+  }
+
+  // Trace timestamps are in microseconds; keep full nanosecond precision
+  // instead of the stream's default six significant digits.
+  static void WriteMicros(std::ostream& os, uint64_t ns)
+  {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000),
+             static_cast<unsigned long long>(ns % 1000));
+    os << buf;
+  }
+
+  static void WriteEscaped(std::ostream& os, const std::string& str)
+  {
+    for (char c : str) {
+      if (c == '"' || c == '\\') {
+        os << '\\' << c;
+      } else if (static_cast<unsigned char>(c) >= 0x20) {
+        os << c;
+      }
+    }
+  }
+
+  std::string name_;
+  uint64_t sample_every_;
+  size_t max_events_;
+  Clock clock_;
+  std::atomic<uint64_t> pops_;
+  LatencyHistogram histogram_;
+  mutable std::mutex events_mutex_;
+  std::vector<Event> events_;
+  uint64_t next_event_;
+  uint64_t base_ticks_;
+  uint64_t base_ns_;
+  double ns_per_tick_;
+};
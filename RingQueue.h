@@ -1,7 +1,10 @@
 #ifndef __RingQueue_H__
 #define __RingQueue_H__
 
+#include <memory>
 #include <vector>
+#include <stdint.h>
+#include "QueueTracer.h"
 
 #ifdef __APPLE__
 #include <dispatch/dispatch.h>
@@ -9,13 +12,17 @@
 #include <semaphore.h>
 #include <time.h>
 #include <errno.h>
+#include <string>
+#include "SpillFile.h"
+#include "Watermark.h"
 #endif
 
-template <class DataType>
+// Allocator places the ring storage, see NumaAllocator.h.
+template <class DataType, class Allocator = std::allocator<DataType> >
 class RingQueue
 {
 public:
-    explicit RingQueue(int cap);
+    explicit RingQueue(int cap, const Allocator &alloc = Allocator());
     ~RingQueue();
 
     void Reset();
@@ -26,16 +33,52 @@ public:
 #endif
 
     bool Push(const DataType &data, bool forever = false);
+
+    // Opt-in sojourn-time tracing: Push stamps each slot in an array parallel
+    // to the ring and Pop/PopAll report the stamps to tracer. Items that went
+    // through the spill file are not traced. Call before the queue is shared
+    // between threads; NULL turns tracing off.
+    void SetTracer(const std::shared_ptr<QueueTracer> &tracer);
 #ifdef __APPLE__
     bool Pop(DataType &data, bool forever = false);
 #else
     bool Pop(DataType &data, long msecs = 0);
     void PopAll(std::vector<DataType> &data_arr);
+
+    // Overflow mode for trivially copyable DataType: once the ring is full,
+    // Push appends to memory-mapped segment files under dir instead of
+    // failing or blocking, and Pop drains them in FIFO order before the ring
+    // is used again. Call before the queue is shared between threads.
+    bool EnableSpill(const std::string &dir, size_t segment_bytes = 64 << 20);
+    size_t SpilledSize() const;
+
+    // Edge-triggered backpressure: the watermark sees the queue size after
+    // every Push, Pop and PopAll. NULL turns it off.
+    void SetWatermark(const std::shared_ptr<Watermark> &watermark);
+
+    // Credit-based flow control for the producer: reserves up to n free slots
+    // at once (all n, waiting as needed, if forever is set) and returns how
+    // many were granted. The next that many Pushes use the reserved slots
+    // without touching blank_sem. Credits never exceed the capacity, so n is
+    // clamped to Capacity - Credits(). No credits are granted while items
+    // are spilled, to keep FIFO order.
+    int AcquireCredits(int n, bool forever = false);
+    // Gives unused credits back to the ring.
+    void ReleaseCredits();
+    int Credits() const;
 #endif
 
 private:
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<uint64_t> StampAllocator;
+
+#ifndef __APPLE__
+    bool PushSpill(const DataType &data);
+    void TakeOne(DataType &data);
+    void UpdateWatermark();
+#endif
+
     int _cap;
-    std::vector<DataType> ring;
+    std::vector<DataType, Allocator> ring;
 
 #ifdef __APPLE__
     dispatch_semaphore_t blank_sem;
@@ -47,10 +90,19 @@ private:
 
     int c_step;
     int p_step;
+
+    std::shared_ptr<QueueTracer> tracer;
+    std::vector<uint64_t, StampAllocator> stamps;  // tracer stamp of each slot
+
+#ifndef __APPLE__
+    SpillFile<DataType> *spill;
+    std::shared_ptr<Watermark> watermark;
+    int credits;
+#endif
 };
 
-template<class DataType>
-void RingQueue<DataType>::Reset()
+template<class DataType, class Allocator>
+void RingQueue<DataType, Allocator>::Reset()
 {
     c_step = p_step = 0;
 #ifdef __APPLE__
@@ -59,44 +111,59 @@ void RingQueue<DataType>::Reset()
 #else
     sem_init(&blank_sem, 0, _cap);
     sem_init(&data_sem, 0, 0);
+    credits = 0;
+    if (spill) {
+        spill->Clear();
+    }
 #endif
 }
 
-template<class DataType>
-RingQueue<DataType>::RingQueue(int cap):_cap(cap), ring(cap)
+template<class DataType, class Allocator>
+RingQueue<DataType, Allocator>::RingQueue(int cap, const Allocator &alloc):_cap(cap), ring(cap, alloc), stamps(StampAllocator(alloc))
 {
+#ifndef __APPLE__
+    spill = NULL;
+#endif
     Reset();
 }
 
-template<class DataType>
-RingQueue<DataType>::~RingQueue()
+template<class DataType, class Allocator>
+RingQueue<DataType, Allocator>::~RingQueue()
 {
 #ifndef __APPLE__
     sem_destroy(&blank_sem);
     sem_destroy(&data_sem);
+    delete spill;
 #endif
 }
 
+template<class DataType, class Allocator>
+void RingQueue<DataType, Allocator>::SetTracer(const std::shared_ptr<QueueTracer> &tracer)
+{
+    this->tracer = tracer;
+    stamps.assign(tracer ? _cap : 0, 0);
+}
+
 #ifndef __APPLE__
-template<class DataType>
-bool RingQueue<DataType>::IsEmpty() const
+template<class DataType, class Allocator>
+bool RingQueue<DataType, Allocator>::IsEmpty() const
 {
     int data_sem_value = 0;
-    sem_getvalue(&data_sem, &data_sem_value);
+    sem_getvalue(const_cast<sem_t *>(&data_sem), &data_sem_value);
     return data_sem_value == 0;
 }
 
-template<class DataType>
-bool RingQueue<DataType>::IsFull() const
+template<class DataType, class Allocator>
+bool RingQueue<DataType, Allocator>::IsFull() const
 {
     int blank_sem_value = 0;
-    sem_getvalue(&blank_sem, &blank_sem_value);
+    sem_getvalue(const_cast<sem_t *>(&blank_sem), &blank_sem_value);
     return blank_sem_value == 0;
 }
 #endif
 
-template<class DataType>
-bool RingQueue<DataType>::Push(const DataType &data, bool forever/* = false*/)
+template<class DataType, class Allocator>
+bool RingQueue<DataType, Allocator>::Push(const DataType &data, bool forever/* = false*/)
 {
 #ifdef __APPLE__
     if (!forever) {
@@ -105,11 +172,24 @@ bool RingQueue<DataType>::Push(const DataType &data, bool forever/* = false*/)
         dispatch_semaphore_wait(blank_sem, DISPATCH_TIME_FOREVER);
     }
 #else
-    if ((!forever && !sem_trywait(&blank_sem)) ||
-        (forever && !sem_wait(&blank_sem))) {
+    if (credits > 0) {
+        // slot already reserved by AcquireCredits
+        credits--;
+    } else if (spill) {
+        // once items are spilled, later ones follow them to keep FIFO order
+        if (spill->Size() > 0 || sem_trywait(&blank_sem)) {
+            return PushSpill(data);
+        }
+    } else if ((!forever && sem_trywait(&blank_sem)) ||
+               (forever && sem_wait(&blank_sem))) {
+        return false;
+    }
 #endif
 
     ring[p_step] = data;
+    if (tracer) {
+        stamps[p_step] = tracer->Now();
+    }
 
 #ifdef __APPLE__
     dispatch_semaphore_signal(data_sem);
@@ -119,18 +199,17 @@ bool RingQueue<DataType>::Push(const DataType &data, bool forever/* = false*/)
 
     p_step++;
     p_step %= _cap;
-    return true;
-
 #ifndef __APPLE__
-    } else {
-        return false;
+    if (watermark) {
+        UpdateWatermark();
     }
 #endif
+    return true;
 }
 
 #ifdef __APPLE__
-template<class DataType>
-bool RingQueue<DataType>::Pop(DataType &data, bool forever/* = false*/)
+template<class DataType, class Allocator>
+bool RingQueue<DataType, Allocator>::Pop(DataType &data, bool forever/* = false*/)
 {
     if (!forever) {
         dispatch_semaphore_wait(data_sem, DISPATCH_TIME_NOW);
@@ -138,14 +217,17 @@ bool RingQueue<DataType>::Pop(DataType &data, bool forever/* = false*/)
         dispatch_semaphore_wait(data_sem, DISPATCH_TIME_FOREVER);
     }
     data = ring[c_step];
+    if (tracer) {
+        tracer->RecordSojourn(stamps[c_step]);
+    }
     dispatch_semaphore_signal(blank_sem);
     c_step++;
     c_step %= _cap;
     return true;
 }
 #else
-template<class DataType>
-bool RingQueue<DataType>::Pop(DataType &data, long msecs)
+template<class DataType, class Allocator>
+bool RingQueue<DataType, Allocator>::Pop(DataType &data, long msecs)
 {
     int eval;
     if (msecs == 0) {
@@ -170,10 +252,10 @@ bool RingQueue<DataType>::Pop(DataType &data, long msecs)
     }
 
     if (0 == eval) {
-        data = ring[c_step];
-        sem_post(&blank_sem);
-        c_step++;
-        c_step %= _cap;
+        TakeOne(data);
+        if (watermark) {
+            UpdateWatermark();
+        }
     } else if (eval == -1 && errno == ETIMEDOUT) {
         // timeout
     }
@@ -181,21 +263,135 @@ bool RingQueue<DataType>::Pop(DataType &data, long msecs)
     return (0 == eval);
 }
 
-template<class DataType>
-void RingQueue<DataType>::PopAll(std::vector<DataType> &data_arr)
+template<class DataType, class Allocator>
+void RingQueue<DataType, Allocator>::PopAll(std::vector<DataType> &data_arr)
 {
     while(1) {
         if (!sem_trywait(&data_sem)) {
-            const DataType &data = ring[c_step];
-            data_arr.emplace_back(data);
-            sem_post(&blank_sem);
-            c_step++;
-            c_step %= _cap;
+            data_arr.emplace_back();
+            TakeOne(data_arr.back());
+        } else {
+            break;
+        }
+    }
+    if (watermark) {
+        UpdateWatermark();
+    }
+}
+
+template<class DataType, class Allocator>
+bool RingQueue<DataType, Allocator>::EnableSpill(const std::string &dir, size_t segment_bytes/* = 64 << 20*/)
+{
+    if (spill) {
+        return false;
+    }
+    spill = new SpillFile<DataType>(dir, segment_bytes);
+    return true;
+}
+
+template<class DataType, class Allocator>
+size_t RingQueue<DataType, Allocator>::SpilledSize() const
+{
+    return spill ? spill->Size() : 0;
+}
+
+template<class DataType, class Allocator>
+bool RingQueue<DataType, Allocator>::PushSpill(const DataType &data)
+{
+    if (!spill->Append(data)) {
+        return false;
+    }
+    sem_post(&data_sem);
+    if (watermark) {
+        UpdateWatermark();
+    }
+    return true;
+}
+
+// Consumes the item a data_sem token was taken for. Ring items are always
+// older than spilled ones, because the producer only goes back to the ring
+// after the spill file has been drained.
+template<class DataType, class Allocator>
+void RingQueue<DataType, Allocator>::TakeOne(DataType &data)
+{
+    if (spill) {
+        int blank_sem_value = 0;
+        sem_getvalue(&blank_sem, &blank_sem_value);
+        if (blank_sem_value == _cap && spill->Pop(data)) {
+            return;
+        }
+    }
+
+    data = ring[c_step];
+    if (tracer) {
+        tracer->RecordSojourn(stamps[c_step]);
+    }
+    sem_post(&blank_sem);
+    c_step++;
+    c_step %= _cap;
+}
+
+template<class DataType, class Allocator>
+void RingQueue<DataType, Allocator>::SetWatermark(const std::shared_ptr<Watermark> &watermark)
+{
+    this->watermark = watermark;
+}
+
+// data_sem counts every queued item, in the ring or in the spill file.
+template<class DataType, class Allocator>
+void RingQueue<DataType, Allocator>::UpdateWatermark()
+{
+    // producer and consumer update without a common lock
+    watermark->UpdateFrom([this] {
+        int data_sem_value = 0;
+        sem_getvalue(&data_sem, &data_sem_value);
+        return data_sem_value;
+    });
+}
+
+template<class DataType, class Allocator>
+int RingQueue<DataType, Allocator>::AcquireCredits(int n, bool forever/* = false*/)
+{
+    if (spill && spill->Size() > 0) {
+        return 0;
+    }
+    // held credits are slots nobody can fill, so waiting for more than the
+    // remaining capacity would never end
+    if (n > _cap - credits) {
+        n = _cap - credits;
+    }
+    int granted = 0;
+    while (granted < n) {
+        int eval;
+        if (forever) {
+            while ((eval = sem_wait(&blank_sem)) == -1 && errno == EINTR) {
+                continue;
+            }
         } else {
+            eval = sem_trywait(&blank_sem);
+        }
+        if (eval != 0) {
             break;
         }
+        granted++;
+    }
+    credits += granted;
+    return granted;
+}
+
+template<class DataType, class Allocator>
+void RingQueue<DataType, Allocator>::ReleaseCredits()
+{
+    for (; credits > 0; credits--) {
+        sem_post(&blank_sem);
     }
 }
+
+template<class DataType, class Allocator>
+int RingQueue<DataType, Allocator>::Credits() const
+{
+    return credits;
+}
 #endif
 
 #endif
@@ -0,0 +1,170 @@
+#ifndef __SpillFile_H__
+#define __SpillFile_H__
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string.h>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// FIFO overflow storage for trivially copyable items, kept in memory-mapped
+// segment files. The writer appends to the last segment and rotates to a new
+// one when it is full; the reader drains the first segment and drops it once
+// it is consumed. Segment files are unlinked right after creation, so nothing
+// is left behind if the process dies.
+//
+// One writer and one reader may use it concurrently.
+template <class DataType>
+class SpillFile
+{
+public:
+    SpillFile(const std::string &dir, size_t segment_bytes);
+    ~SpillFile();
+
+    bool Append(const DataType &data);
+    bool Pop(DataType &data);
+    void Clear();
+
+    size_t Size() const { return _size.load(std::memory_order_acquire); }
+    size_t Segments() const;
+
+private:
+    struct Segment
+    {
+        int fd;
+        DataType *items;
+        size_t read;
+        size_t write;
+    };
+
+    bool OpenSegment();
+    void CloseSegment(Segment &seg);
+
+    std::string _dir;
+    size_t _segment_items;
+    std::deque<Segment> _segments;
+    mutable std::mutex _mutex;
+    std::atomic<size_t> _size;
+};
+
+template<class DataType>
+SpillFile<DataType>::SpillFile(const std::string &dir, size_t segment_bytes)
+    : _dir(dir), _segment_items(segment_bytes / sizeof(DataType)), _size(0)
+{
+    static_assert(std::is_trivially_copyable<DataType>::value,
+                  "SpillFile needs a trivially copyable DataType");
+    if (_segment_items == 0) {
+        _segment_items = 1;
+    }
+}
+
+template<class DataType>
+SpillFile<DataType>::~SpillFile()
+{
+    Clear();
+}
+
+template<class DataType>
+size_t SpillFile<DataType>::Segments() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _segments.size();
+}
+
+template<class DataType>
+bool SpillFile<DataType>::OpenSegment()
+{
+    std::string path = _dir + "/ringqueue-spill-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        return false;
+    }
+    unlink(path.c_str());
+
+    size_t bytes = _segment_items * sizeof(DataType);
+    if (ftruncate(fd, bytes) != 0) {
+        close(fd);
+        return false;
+    }
+    void *addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    Segment seg;
+    seg.fd = fd;
+    seg.items = static_cast<DataType *>(addr);
+    seg.read = 0;
+    seg.write = 0;
+    _segments.push_back(seg);
+    return true;
+}
+
+template<class DataType>
+void SpillFile<DataType>::CloseSegment(Segment &seg)
+{
+    munmap(seg.items, _segment_items * sizeof(DataType));
+    close(seg.fd);
+}
+
+template<class DataType>
+bool SpillFile<DataType>::Append(const DataType &data)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_segments.empty() || _segments.back().write == _segment_items) {
+        if (!OpenSegment()) {
+            return false;
+        }
+    }
+
+    Segment &seg = _segments.back();
+    memcpy(static_cast<void *>(&seg.items[seg.write]), &data, sizeof(DataType));
+    seg.write++;
+    _size.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+template<class DataType>
+bool SpillFile<DataType>::Pop(DataType &data)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_size.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+
+    Segment &seg = _segments.front();
+    memcpy(static_cast<void *>(&data), &seg.items[seg.read], sizeof(DataType));
+    seg.read++;
+    _size.fetch_sub(1, std::memory_order_release);
+
+    if (seg.read == seg.write) {
+        if (_segments.size() > 1) {
+            CloseSegment(seg);
+            _segments.pop_front();
+        } else {
+            // last segment drained: rewind it instead of rotating files
+            seg.read = seg.write = 0;
+        }
+    }
+    return true;
+}
+
+template<class DataType>
+void SpillFile<DataType>::Clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (Segment &seg : _segments) {
+        CloseSegment(seg);
+    }
+    _segments.clear();
+    _size.store(0, std::memory_order_release);
+}
+
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#ifdef __linux__
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+// Edge-triggered high/low watermarks on a queue size, for backpressure.
+//
+// The queue reports its size after every change. Crossing the high watermark
+// upwards fires once, and nothing more fires until the size falls back to the
+// low watermark, so upstream can throttle before the queue is full instead of
+// polling it. On every crossing the callback is called with the new state and,
+// if requested, the eventfd is signalled for poll/epoll based producers.
+//
+// The callback runs on the pushing or popping thread, possibly under the
+// queue lock, so it must be short and must not call back into the queue.
+class Watermark {
+public:
+  // Called with true when the size reached high, false when it fell to low.
+  typedef std::function<void(bool high)> Callback;
+
+  Watermark(int high, int low, const Callback& callback = Callback(), bool use_eventfd = false)
+    : high_(high), low_(low < high ? low : high - 1), callback_(callback), is_high_(false), fd_(-1)
+  {
+#ifdef __linux__
+    if (use_eventfd) {
+      fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+#else
+    (void)use_eventfd;
+#endif
+  }
+
+  ~Watermark()
+  {
+#ifdef __linux__
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+#endif
+  }
+
+  Watermark(const Watermark&) = delete;
+  Watermark& operator=(const Watermark&) = delete;
+
+  int High() const
+  {
+    return high_;
+  }
+
+  int Low() const
+  {
+    return low_;
+  }
+
+  // True between crossing high and falling back to low.
+  bool IsHigh() const
+  {
+    return is_high_.load(std::memory_order_acquire);
+  }
+
+  // Becomes readable on every crossing, -1 if not requested. Check IsHigh()
+  // after reading it to learn the current state.
+  int EventFd() const
+  {
+    return fd_;
+  }
+
+  // For callers that serialize their updates, e.g. under the queue lock.
+  void Update(int size)
+  {
+    Transition(size);
+  }
+
+  // For callers that read the size without a common lock, where a stale
+  // size may win the race against a newer one. The size is read again with
+  // read_size() after every transition, and the opposite edge fires if it
+  // was already crossed, so the state always ends up matching a size read
+  // after the last transition.
+  template <typename ReadSize>
+  void UpdateFrom(ReadSize read_size)
+  {
+    while (Transition(read_size())) {
+    }
+  }
+
+private:
+  // Returns true if this call crossed a watermark.
+  bool Transition(int size)
+  {
+    bool is_high = is_high_.load(std::memory_order_relaxed);
+    if (!is_high && size >= high_) {
+      if (is_high_.compare_exchange_strong(is_high, true, std::memory_order_acq_rel)) {
+        Fire(true);
+        return true;
+      }
+    } else if (is_high && size <= low_) {
+      if (is_high_.compare_exchange_strong(is_high, false, std::memory_order_acq_rel)) {
+        Fire(false);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Fire(bool high)
+  {
+    if (callback_) {
+      callback_(high);
+    }
+#ifdef __linux__
+    if (fd_ >= 0) {
+      uint64_t one = 1;
+      ssize_t ret = write(fd_, &one, sizeof(one));
+      (void)ret;
+    }
+#endif
+  }
+
+  int high_;
+  int low_;
+  Callback callback_;
+  std::atomic<bool> is_high_;
+  int fd_;
+};
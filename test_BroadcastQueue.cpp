@@ -0,0 +1,272 @@
+#include "BroadcastQueue.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+
+class TestBroadcastQueue {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running BroadcastQueue Unit Tests ===" << std::endl;
+
+        test_capacity_rounding();
+        test_every_reader_sees_every_item();
+        test_gating_on_slowest_reader();
+        test_pop_all_and_max_count();
+        test_consume_batch();
+        test_reader_dependencies();
+        test_pop_timeout();
+        test_concurrent_readers();
+        test_late_dependent_reader();
+        test_blocking_pop_sleeps();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_capacity_rounding() {
+        std::cout << "\n--- Testing Capacity Rounding ---" << std::endl;
+
+        BroadcastQueue<int> queue(5);
+        assert_true(queue.Capacity() == 8, "Capacity should round up to 8");
+        assert_true(queue.IsEmpty(), "Queue should be empty initially");
+        assert_true(queue.Cursor() == -1, "Cursor should start at -1");
+    }
+
+    void test_every_reader_sees_every_item() {
+        std::cout << "\n--- Testing Broadcast to Every Reader ---" << std::endl;
+
+        BroadcastQueue<int> queue(4);
+        auto* r1 = queue.AddReader();
+        auto* r2 = queue.AddReader();
+
+        queue.Push(1);
+        queue.Push(2);
+
+        int a = 0, b = 0;
+        assert_true(r1->Pop(a) && a == 1, "Reader 1 should pop 1");
+        assert_true(r2->Pop(b) && b == 1, "Reader 2 should pop 1");
+        assert_true(r1->Pop(a) && a == 2, "Reader 1 should pop 2");
+        assert_true(r2->Pop(b) && b == 2, "Reader 2 should pop 2");
+        assert_true(!r1->Pop(a), "Reader 1 should have nothing left");
+        assert_true(queue.IsEmpty(), "Queue should be empty once all readers consumed");
+    }
+
+    void test_gating_on_slowest_reader() {
+        std::cout << "\n--- Testing Gating on Slowest Reader ---" << std::endl;
+
+        BroadcastQueue<int> queue(2);
+        auto* fast = queue.AddReader();
+        auto* slow = queue.AddReader();
+
+        assert_true(queue.Push(1) && queue.Push(2), "Should push up to capacity");
+        int v = 0;
+        fast->Pop(v);
+        fast->Pop(v);
+        assert_true(!queue.Push(3), "Push should fail while slow reader is a ring behind");
+        assert_true(queue.IsFull(), "Queue should be full for the slowest reader");
+
+        slow->Pop(v);
+        assert_true(v == 1, "Slow reader should still see 1");
+        assert_true(queue.Push(3), "Push should succeed after slow reader advanced");
+        assert_true(slow->Pop(v) && v == 2, "Slow reader should see 2");
+        assert_true(slow->Pop(v) && v == 3, "Slow reader should see 3");
+    }
+
+    void test_pop_all_and_max_count() {
+        std::cout << "\n--- Testing PopAll and MaxCount ---" << std::endl;
+
+        BroadcastQueue<int> queue(8);
+        auto* reader = queue.AddReader();
+        for (int i = 0; i < 5; i++) {
+            queue.Push(i);
+        }
+
+        std::vector<int> data_arr;
+        assert_true(reader->PopAll(data_arr, 2) == 2, "PopAll should honour maxCount");
+        assert_true(reader->Available() == 3, "Three items should remain available");
+        assert_true(reader->PopAll(data_arr) == 3, "PopAll should read the rest");
+        assert_true(data_arr.size() == 5 && data_arr[0] == 0 && data_arr[4] == 4,
+                    "PopAll should append in publish order");
+        assert_true(reader->Sequence() == 4, "Reader sequence should be 4");
+    }
+
+    void test_consume_batch() {
+        std::cout << "\n--- Testing Consume Batch ---" << std::endl;
+
+        BroadcastQueue<int> queue(8);
+        auto* reader = queue.AddReader();
+        for (int i = 1; i <= 3; i++) {
+            queue.Push(i);
+        }
+
+        int sum = 0;
+        int end_count = 0;
+        int64_t last_seq = -1;
+        int n = reader->Consume([&](const int& data, int64_t seq, bool end_of_batch) {
+            sum += data;
+            last_seq = seq;
+            if (end_of_batch) {
+                end_count++;
+            }
+        });
+        assert_true(n == 3 && sum == 6, "Consume should visit all three items");
+        assert_true(end_count == 1 && last_seq == 2, "Only the last item should end the batch");
+    }
+
+    void test_reader_dependencies() {
+        std::cout << "\n--- Testing Reader Dependencies ---" << std::endl;
+
+        BroadcastQueue<int> queue(4);
+        auto* stage1 = queue.AddReader();
+        auto* stage2 = queue.AddReader({stage1});
+
+        queue.Push(10);
+        queue.Push(20);
+
+        int v = 0;
+        assert_true(!stage2->Pop(v), "Stage 2 should wait for stage 1");
+        stage1->Pop(v);
+        assert_true(stage2->Available() == 1, "Stage 2 should see what stage 1 consumed");
+        assert_true(stage2->Pop(v) && v == 10, "Stage 2 should pop 10");
+        assert_true(!stage2->Pop(v), "Stage 2 should not pass stage 1");
+    }
+
+    void test_pop_timeout() {
+        std::cout << "\n--- Testing Pop Timeout ---" << std::endl;
+
+        BroadcastQueue<int> queue(4);
+        auto* reader = queue.AddReader();
+
+        int v = 0;
+        auto start = std::chrono::steady_clock::now();
+        bool ok = reader->Pop(v, 50);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        assert_true(!ok, "Pop should time out on an empty queue");
+        assert_true(elapsed.count() >= 40 && elapsed.count() < 500, "Pop should wait about 50ms");
+    }
+
+    void test_concurrent_readers() {
+        std::cout << "\n--- Testing Concurrent Readers ---" << std::endl;
+
+        const int kItems = 100000;
+        const int kReaders = 3;
+        BroadcastQueue<long> queue(64);
+        std::vector<BroadcastQueue<long>::Reader*> readers;
+        for (int i = 0; i < kReaders; i++) {
+            readers.push_back(queue.AddReader());
+        }
+        auto* last_stage = queue.AddReader({readers[0], readers[1]});
+
+        std::vector<long> sums(kReaders + 1, 0);
+        std::vector<bool> ordered(kReaders + 1, true);
+        std::vector<std::thread> threads;
+        for (int r = 0; r <= kReaders; r++) {
+            auto* reader = r < kReaders ? readers[r] : last_stage;
+            threads.emplace_back([&, r, reader]() {
+                long expected = 0;
+                std::vector<long> batch;
+                while (expected < kItems) {
+                    batch.clear();
+                    reader->PopAll(batch);
+                    for (long v : batch) {
+                        if (v != expected) {
+                            ordered[r] = false;
+                        }
+                        sums[r] += v;
+                        expected++;
+                    }
+                    if (batch.empty()) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        for (long i = 0; i < kItems; i++) {
+            queue.Push(i, true);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        long expected_sum = static_cast<long>(kItems) * (kItems - 1) / 2;
+        bool all_ok = true;
+        for (int r = 0; r <= kReaders; r++) {
+            all_ok = all_ok && ordered[r] && sums[r] == expected_sum;
+        }
+        assert_true(all_ok, "Every reader should see every item in order");
+        assert_true(queue.IsEmpty(), "Queue should be empty after all readers finished");
+    }
+
+    void test_late_dependent_reader() {
+        std::cout << "\n--- Testing Late Dependent Reader ---" << std::endl;
+
+        BroadcastQueue<int> queue(8);
+        auto* first = queue.AddReader();
+        queue.Push(1);
+        queue.Push(2);
+        queue.Push(3);
+        auto* late = queue.AddReader({first});
+
+        std::vector<int> data_arr;
+        assert_true(late->Available() == 0, "Late reader should not report a negative count");
+        assert_true(late->PopAll(data_arr) == 0 && data_arr.empty(), "Late reader should not go backwards");
+        assert_true(late->Sequence() == 2, "Late reader should keep its start sequence");
+
+        first->PopAll(data_arr);
+        queue.Push(4);
+        first->PopAll(data_arr);
+        data_arr.clear();
+        assert_true(late->PopAll(data_arr) == 1 && data_arr[0] == 4,
+                    "Late reader should only see items published after it joined");
+    }
+
+    void test_blocking_pop_sleeps() {
+        std::cout << "\n--- Testing Blocking Pop Sleeps ---" << std::endl;
+
+        BroadcastQueue<int> queue(4);
+        auto* reader = queue.AddReader();
+        int v = 0;
+        bool ok = false;
+        std::clock_t cpu_start = std::clock();
+        std::thread consumer([&]() { ok = reader->Pop(v, -1); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        queue.Push(7);
+        consumer.join();
+        double cpu_ms = 1000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+        assert_true(ok && v == 7, "Blocking Pop should wake up on Push");
+        assert_true(cpu_ms < 100, "Blocking Pop should sleep instead of spinning");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestBroadcastQueue test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
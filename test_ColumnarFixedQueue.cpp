@@ -0,0 +1,247 @@
+#include "ColumnarFixedQueue.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <tuple>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+
+class TestColumnarFixedQueue {
+private:
+    typedef ColumnarFixedQueue<int64_t, double, int32_t, float, uint16_t> Queue;
+    typedef Queue::Row Row;
+
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+    template <typename T>
+    static bool compare(const T& a, ColumnOp op, const T& b) {
+        switch (op) {
+            case ColumnOp::kLess: return a < b;
+            case ColumnOp::kLessEqual: return a <= b;
+            case ColumnOp::kGreater: return a > b;
+            case ColumnOp::kGreaterEqual: return a >= b;
+            case ColumnOp::kEqual: return a == b;
+            default: return a != b;
+        }
+    }
+
+    static Row make_row(int i) {
+        double price = (rand() % 2000) / 10.0;
+        if (i % 101 == 0) {
+            price = std::nan("");
+        }
+        return Row(static_cast<int64_t>(rand() % 100) - 50, price, static_cast<int32_t>(rand() % 16) - 8,
+                   static_cast<float>(rand() % 100) / 4.0f, static_cast<uint16_t>(rand() % 5));
+    }
+
+    static bool same_rows(const std::vector<Row>& a, const std::vector<Row>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            // NaN prices compare unequal, so compare the row index column first
+            if (std::get<0>(a[i]) != std::get<0>(b[i]) || std::get<2>(a[i]) != std::get<2>(b[i]) ||
+                std::get<3>(a[i]) != std::get<3>(b[i]) || std::get<4>(a[i]) != std::get<4>(b[i])) {
+                return false;
+            }
+            double pa = std::get<1>(a[i]);
+            double pb = std::get<1>(b[i]);
+            if (!(pa == pb || (std::isnan(pa) && std::isnan(pb)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running ColumnarFixedQueue Unit Tests ===" << std::endl;
+        std::cout << "AVX2 scan: " << (ColumnScanHasAvx2() ? "yes" : "no") << std::endl;
+
+        test_basic_push_and_get();
+        test_column_scan_kernels();
+        test_filters_against_reference();
+        test_eviction_after_select();
+        test_filter_if_and_get_column();
+        test_max_count_and_append();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_basic_push_and_get() {
+        std::cout << "\n--- Testing Basic Push and GetItems ---" << std::endl;
+
+        ColumnarFixedQueue<int, std::string> queue(3);
+        assert_true(queue.IsEmpty() && queue.Capacity() == 3, "Queue should start empty");
+        queue.Push(1, "a");
+        queue.Push(2, "b");
+        queue.Push(std::make_tuple(3, std::string("c")));
+        queue.Push(4, "d");
+        assert_true(queue.IsFull() && queue.Size() == 3, "Queue should stay at capacity");
+
+        std::vector<ColumnarFixedQueue<int, std::string>::Row> rows;
+        queue.GetItems(rows);
+        assert_true(rows.size() == 3 && std::get<0>(rows[0]) == 2 && std::get<1>(rows[2]) == "d",
+                    "Oldest row should be dropped");
+
+        queue.Clear();
+        queue.GetItems(rows);
+        assert_true(queue.IsEmpty() && rows.empty(), "Clear should empty the queue");
+    }
+
+    void test_column_scan_kernels() {
+        std::cout << "\n--- Testing Column Scan Kernels ---" << std::endl;
+
+        std::vector<int32_t> ints(64);
+        std::vector<int64_t> longs(64);
+        std::vector<float> floats(64);
+        std::vector<double> doubles(64);
+        for (int i = 0; i < 64; i++) {
+            ints[i] = i % 7 - 3;
+            longs[i] = (i % 5 - 2) * 1000000000000LL;
+            floats[i] = (i % 9) * 0.5f;
+            doubles[i] = i % 11 == 0 ? std::nan("") : (i % 3) * 1.5;
+        }
+        const ColumnOp ops[] = {ColumnOp::kLess, ColumnOp::kLessEqual, ColumnOp::kGreater,
+                                ColumnOp::kGreaterEqual, ColumnOp::kEqual, ColumnOp::kNotEqual};
+        bool ok = true;
+        for (ColumnOp op : ops) {
+            for (int n = 0; n <= 64; n += 13) {
+                ok = ok && ColumnScan(ints.data(), n, op, 0) == ColumnScanScalar(ints.data(), n, op, 0);
+                ok = ok && ColumnScan(longs.data(), n, op, int64_t(1000000000000LL)) ==
+                               ColumnScanScalar(longs.data(), n, op, int64_t(1000000000000LL));
+                ok = ok && ColumnScan(floats.data(), n, op, 2.0f) == ColumnScanScalar(floats.data(), n, op, 2.0f);
+                ok = ok && ColumnScan(doubles.data(), n, op, 1.5) == ColumnScanScalar(doubles.data(), n, op, 1.5);
+            }
+        }
+        assert_true(ok, "Vectorized scans should match the scalar scan, NaN included");
+    }
+
+    void test_filters_against_reference() {
+        std::cout << "\n--- Testing Filters Against Reference ---" << std::endl;
+
+        srand(5);
+        const ColumnOp ops[] = {ColumnOp::kLess, ColumnOp::kLessEqual, ColumnOp::kGreater,
+                                ColumnOp::kGreaterEqual, ColumnOp::kEqual, ColumnOp::kNotEqual};
+        bool ok = true;
+        for (int cap : {1, 7, 64, 100, 1000}) {
+            Queue queue(cap);
+            std::deque<Row> reference;
+            for (int i = 0; i < cap * 3 + 17; i++) {
+                Row row = make_row(i);
+                queue.Push(row);
+                reference.push_back(row);
+                if (static_cast<int>(reference.size()) > cap) {
+                    reference.pop_front();
+                }
+            }
+            for (ColumnOp op : ops) {
+                Queue::Selection sel = queue.Select();
+                queue.Filter<1>(sel, op, 100.0);
+                queue.Filter<2>(sel, ColumnOp::kGreaterEqual, -4);
+                queue.Filter<0>(sel, op, int64_t(0));
+
+                std::vector<Row> expected;
+                for (const Row& row : reference) {
+                    if (compare(std::get<1>(row), op, 100.0) && std::get<2>(row) >= -4 &&
+                        compare(std::get<0>(row), op, int64_t(0))) {
+                        expected.push_back(row);
+                    }
+                }
+                std::vector<Row> rows;
+                queue.GetItems(sel, rows);
+                ok = ok && same_rows(rows, expected) && sel.Count() == static_cast<int>(expected.size());
+            }
+        }
+        assert_true(ok, "Chained filters should match a row-wise reference");
+
+        Queue queue(10);
+        Queue::Selection sel = queue.Select();
+        queue.Filter<3>(sel, ColumnOp::kLess, 1.0f);
+        assert_true(sel.IsEmpty(), "Selecting from an empty queue should be empty");
+    }
+
+    void test_eviction_after_select() {
+        std::cout << "\n--- Testing Eviction After Select ---" << std::endl;
+
+        ColumnarFixedQueue<int32_t> queue(200);
+        for (int i = 0; i < 200; i++) {
+            queue.Push(i);
+        }
+        ColumnarFixedQueue<int32_t>::Selection sel = queue.Select();
+        for (int i = 200; i < 330; i++) {
+            queue.Push(i);
+        }
+        std::vector<int32_t> values;
+        queue.GetColumn<0>(sel, values);
+        assert_true(values.size() == 70 && values[0] == 130 && values[69] == 199,
+                    "Evicted rows should be skipped and new rows not selected");
+
+        queue.Filter<0>(sel, ColumnOp::kGreater, 150);
+        queue.GetColumn<0>(sel, values);
+        assert_true(values.size() == 49 && sel.Count() == 49 && values[0] == 151,
+                    "Filter should drop evicted rows from the selection");
+
+        queue.Clear();
+        queue.GetColumn<0>(sel, values);
+        assert_true(values.empty(), "Cleared rows should not be returned");
+    }
+
+    void test_filter_if_and_get_column() {
+        std::cout << "\n--- Testing FilterIf and GetColumn ---" << std::endl;
+
+        ColumnarFixedQueue<int, std::string, double> queue(50);
+        for (int i = 0; i < 80; i++) {
+            queue.Push(i, i % 3 == 0 ? "buy" : "sell", i * 0.5);
+        }
+        auto sel = queue.Select();
+        queue.FilterIf<1>(sel, [](const std::string& side) { return side == "buy"; });
+        queue.Filter<2>(sel, ColumnOp::kLess, 30.0);
+        std::vector<int> ids;
+        queue.GetColumn<0>(sel, ids);
+        assert_true(ids.size() == 10 && ids[0] == 30 && ids[9] == 57, "FilterIf should combine with Filter");
+    }
+
+    void test_max_count_and_append() {
+        std::cout << "\n--- Testing maxCount and Append ---" << std::endl;
+
+        ColumnarFixedQueue<int64_t> queue(500);
+        for (int i = 0; i < 500; i++) {
+            queue.Push(i);
+        }
+        auto sel = queue.Select();
+        queue.Filter<0>(sel, ColumnOp::kGreaterEqual, int64_t(100));
+        std::vector<std::tuple<int64_t>> rows;
+        queue.GetItems(sel, rows, 5);
+        assert_true(rows.size() == 5 && std::get<0>(rows[4]) == 104, "maxCount should return the oldest matches");
+        queue.GetItems(sel, rows, 2, true);
+        assert_true(rows.size() == 7 && std::get<0>(rows[6]) == 101, "Append should keep previous results");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestColumnarFixedQueue test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
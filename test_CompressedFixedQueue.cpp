@@ -0,0 +1,203 @@
+#include "CompressedFixedQueue.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <limits>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+class TestCompressedFixedQueue {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+    template <typename T>
+    static bool same_bits(const std::vector<T>& a, const std::deque<T>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (memcmp(&a[i], &b[i], sizeof(T)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Pushes values through a queue and a reference deque of the same
+    // capacity, checking the queue content against it along the way.
+    template <typename T, typename Gen>
+    bool matches_reference(int cap, int pushes, Gen gen) {
+        CompressedFixedQueue<T> queue(cap);
+        std::deque<T> reference;
+        std::vector<T> result;
+        bool ok = true;
+        for (int i = 0; i < pushes && ok; i++) {
+            T value = gen(i);
+            queue.Push(value);
+            reference.push_back(value);
+            if (static_cast<int>(reference.size()) > cap) {
+                reference.pop_front();
+            }
+            if (i % 97 == 0 || i == pushes - 1) {
+                queue.GetItems(result);
+                ok = same_bits(result, reference) && queue.Size() == static_cast<int>(reference.size());
+            }
+        }
+        return ok;
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running CompressedFixedQueue Unit Tests ===" << std::endl;
+
+        test_integers_round_trip();
+        test_signed_extremes();
+        test_doubles_round_trip();
+        test_floats_round_trip();
+        test_small_capacity();
+        test_get_items_filter_and_max_count();
+        test_memory_savings();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_integers_round_trip() {
+        std::cout << "\n--- Testing Integer Round Trip ---" << std::endl;
+
+        assert_true(matches_reference<int>(1000, 5000, [](int i) { return 1000 + (i * 37) % 200; }),
+                    "Small-range ints should round trip");
+        assert_true(matches_reference<uint64_t>(700, 3000, [](int i) { return uint64_t(1600000000000ULL) + i * 1000; }),
+                    "Timestamps should round trip");
+        assert_true(matches_reference<uint8_t>(300, 1000, [](int i) { return static_cast<uint8_t>(i); }),
+                    "Bytes should round trip");
+        assert_true(matches_reference<int>(500, 2000, [](int) { return 42; }),
+                    "Constant values should round trip");
+    }
+
+    void test_signed_extremes() {
+        std::cout << "\n--- Testing Signed Extremes ---" << std::endl;
+
+        assert_true(matches_reference<int64_t>(300, 1000, [](int i) {
+                        return i % 2 ? std::numeric_limits<int64_t>::max() : std::numeric_limits<int64_t>::min() + i;
+                    }),
+                    "Full int64 range should round trip");
+        assert_true(matches_reference<short>(300, 1000, [](int i) { return static_cast<short>(-i * 31); }),
+                    "Negative shorts should round trip");
+    }
+
+    void test_doubles_round_trip() {
+        std::cout << "\n--- Testing Double Round Trip ---" << std::endl;
+
+        srand(3);
+        double walk = 100.0;
+        assert_true(matches_reference<double>(1000, 5000, [&walk](int) {
+                        walk += (rand() % 21 - 10) * 0.01;
+                        return walk;
+                    }),
+                    "Random walk should round trip bit-exactly");
+        assert_true(matches_reference<double>(300, 1000, [](int i) {
+                        const double special[] = {0.0, -0.0, std::numeric_limits<double>::infinity(),
+                                                  std::nan(""), 1e-310, -1e300, 1.5};
+                        return special[i % 7];
+                    }),
+                    "Special values should round trip bit-exactly");
+    }
+
+    void test_floats_round_trip() {
+        std::cout << "\n--- Testing Float Round Trip ---" << std::endl;
+
+        assert_true(matches_reference<float>(400, 2000, [](int i) { return std::sin(i * 0.01f) * 50.0f; }),
+                    "Floats should round trip bit-exactly");
+    }
+
+    void test_small_capacity() {
+        std::cout << "\n--- Testing Small Capacity ---" << std::endl;
+
+        assert_true(matches_reference<int>(1, 50, [](int i) { return i; }), "Capacity 1 should keep the latest value");
+        assert_true(matches_reference<double>(5, 50, [](int i) { return i * 0.5; }), "Capacity 5 should keep the latest 5");
+
+        CompressedFixedQueue<int> queue(3);
+        assert_true(queue.IsEmpty() && !queue.IsFull(), "Queue should start empty");
+        queue.Push(1);
+        queue.Push(2);
+        queue.Push(3);
+        assert_true(queue.IsFull() && queue.Size() == 3, "Queue should be full at capacity");
+        queue.Clear();
+        assert_true(queue.IsEmpty(), "Clear should empty the queue");
+    }
+
+    void test_get_items_filter_and_max_count() {
+        std::cout << "\n--- Testing GetItems Filter and MaxCount ---" << std::endl;
+
+        CompressedFixedQueue<int> queue(500);
+        for (int i = 0; i < 600; i++) {
+            queue.Push(i);
+        }
+        std::vector<int> result;
+        queue.GetItems(result, [](int v) { return v % 100 == 0; });
+        assert_true(result.size() == 5 && result[0] == 100 && result[4] == 500, "Filter should see the latest 500 values");
+
+        queue.GetItems(result, 3);
+        assert_true(result.size() == 3 && result[0] == 100 && result[2] == 102, "maxCount should return the oldest values");
+
+        queue.GetItems(result, [](int v) { return v >= 598; }, 0, true);
+        assert_true(result.size() == 5 && result[4] == 599, "Append should keep previous results");
+
+        int sum = 0;
+        int visited = queue.ForEach([&sum](int v) {
+            sum += v;
+            return v < 104;
+        });
+        assert_true(visited == 5 && sum == 100 + 101 + 102 + 103 + 104, "ForEach should stop on false");
+    }
+
+    void test_memory_savings() {
+        std::cout << "\n--- Testing Memory Savings ---" << std::endl;
+
+        const int kCap = 100000;
+        CompressedFixedQueue<double> prices(kCap);
+        CompressedFixedQueue<int64_t> volumes(kCap);
+        srand(11);
+        double price = 250.0;
+        for (int i = 0; i < kCap; i++) {
+            if (rand() % 4 == 0) {
+                price += (rand() % 3 - 1) * 0.25;
+            }
+            prices.Push(price);
+            volumes.Push(100 * (rand() % 50));
+        }
+        size_t raw = kCap * sizeof(double);
+        std::cout << "doubles: " << prices.MemoryBytes() << " bytes, ints: " << volumes.MemoryBytes()
+                  << " bytes, raw: " << raw << " bytes" << std::endl;
+        assert_true(prices.MemoryBytes() < raw / 3, "Slowly changing doubles should compress well");
+        assert_true(volumes.MemoryBytes() < raw / 3, "Small-range ints should compress well");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestCompressedFixedQueue test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
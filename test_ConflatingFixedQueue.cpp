@@ -0,0 +1,184 @@
+#include "ConflatingFixedQueue.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <cstdlib>
+
+struct Quote {
+    std::string symbol;
+    double price;
+
+    Quote(const std::string& s, double p) : symbol(s), price(p) {}
+};
+
+class TestConflatingFixedQueue {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running ConflatingFixedQueue Unit Tests ===" << std::endl;
+
+        test_conflation_keeps_position();
+        test_eviction_when_full();
+        test_pop_returns_key();
+        test_get_items_and_peek();
+        test_against_reference();
+        test_stop_wakes_consumer();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_conflation_keeps_position() {
+        std::cout << "\n--- Testing Conflation Keeps Position ---" << std::endl;
+
+        ConflatingFixedQueue<std::string, Quote> queue(4);
+        queue.Push("AAPL", std::make_shared<Quote>("AAPL", 1.0));
+        queue.Push("MSFT", std::make_shared<Quote>("MSFT", 2.0));
+        bool replaced = queue.Push("AAPL", std::make_shared<Quote>("AAPL", 1.5));
+
+        assert_true(replaced, "Second push for AAPL should replace the queued value");
+        assert_true(queue.Size() == 2, "Size should stay 2 after conflation");
+        assert_true(queue.Conflated() == 1, "One update should be conflated");
+
+        std::shared_ptr<Quote> quote;
+        queue.Pop(quote);
+        assert_true(quote->symbol == "AAPL" && quote->price == 1.5, "AAPL should keep its position with the latest price");
+        queue.Pop(quote);
+        assert_true(quote->symbol == "MSFT", "MSFT should pop second");
+
+        assert_true(!queue.Push("AAPL", std::make_shared<Quote>("AAPL", 1.6)), "Popped key should be queued anew");
+        assert_true(queue.Size() == 1, "Size should be 1");
+    }
+
+    void test_eviction_when_full() {
+        std::cout << "\n--- Testing Eviction When Full ---" << std::endl;
+
+        ConflatingFixedQueue<int, int> queue(2);
+        queue.Push(1, std::make_shared<int>(10));
+        queue.Push(2, std::make_shared<int>(20));
+        queue.Push(2, std::make_shared<int>(21));
+        assert_true(queue.IsFull(), "Queue should be full");
+
+        queue.Push(3, std::make_shared<int>(30));
+        assert_true(queue.Size() == 2, "Size should remain 2 after eviction");
+
+        std::shared_ptr<int> data;
+        assert_true(!queue.Peek(1, data), "Evicted key should leave the index");
+        queue.Pop(data);
+        assert_true(*data == 21, "Oldest remaining key should pop first");
+        queue.Pop(data);
+        assert_true(*data == 30, "Newest key should pop last");
+    }
+
+    void test_pop_returns_key() {
+        std::cout << "\n--- Testing Pop Returns Key ---" << std::endl;
+
+        ConflatingFixedQueue<int, int> queue(3);
+        queue.Push(7, std::make_shared<int>(70));
+        std::shared_ptr<int> data;
+        int key = 0;
+        assert_true(queue.Pop(data, &key) && key == 7 && *data == 70, "Pop should report the key");
+    }
+
+    void test_get_items_and_peek() {
+        std::cout << "\n--- Testing GetItems and Peek ---" << std::endl;
+
+        ConflatingFixedQueue<int, int> queue(5);
+        for (int i = 0; i < 10; i++) {
+            queue.Push(i % 3, std::make_shared<int>(i));
+        }
+        std::vector<int> result;
+        queue.GetItems(result);
+        assert_true(result.size() == 3, "GetItems should return one value per key");
+        assert_true(result[0] == 9 && result[1] == 7 && result[2] == 8, "GetItems should return latest values in key order");
+
+        queue.GetItems(result, 2);
+        assert_true(result.size() == 2, "GetItems should honour maxCount");
+
+        std::shared_ptr<int> data;
+        assert_true(queue.Peek(1, data) && *data == 7, "Peek should return latest value for key");
+        assert_true(queue.Size() == 3, "Peek should not remove the entry");
+    }
+
+    void test_against_reference() {
+        std::cout << "\n--- Testing Against Reference Model ---" << std::endl;
+
+        const int kCap = 16;
+        ConflatingFixedQueue<int, int> queue(kCap);
+        std::deque<int> order;
+        std::map<int, int> latest;
+        srand(12345);
+
+        bool ok = true;
+        for (int step = 0; step < 20000 && ok; step++) {
+            if (rand() % 3 != 0) {
+                int key = rand() % 40;
+                int value = rand();
+                queue.Push(key, std::make_shared<int>(value));
+                if (latest.count(key) == 0) {
+                    if (static_cast<int>(order.size()) == kCap) {
+                        latest.erase(order.front());
+                        order.pop_front();
+                    }
+                    order.push_back(key);
+                }
+                latest[key] = value;
+            } else if (!order.empty()) {
+                std::shared_ptr<int> data;
+                int key = -1;
+                queue.Pop(data, &key);
+                ok = key == order.front() && *data == latest[key];
+                latest.erase(key);
+                order.pop_front();
+            }
+            ok = ok && queue.Size() == static_cast<int>(order.size());
+        }
+        assert_true(ok, "Queue should match the reference model");
+    }
+
+    void test_stop_wakes_consumer() {
+        std::cout << "\n--- Testing Stop Wakes Consumer ---" << std::endl;
+
+        ConflatingFixedQueue<int, int> queue(3);
+        bool popped = true;
+        std::thread consumer([&]() {
+            std::shared_ptr<int> data;
+            popped = queue.Pop(data);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.Stop();
+        consumer.join();
+        assert_true(!popped, "Pop should fail once stopped");
+        assert_true(!queue.Push(1, std::make_shared<int>(1)) && queue.IsEmpty(), "Push should be ignored when stopped");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestConflatingFixedQueue test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+#include "FrequencyFixedQueue.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <cstdlib>
+
+class TestFrequencyFixedQueue {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+    // Skewed stream: key k appears about 1/(k+1) as often as key 0.
+    static int skewed_key(int cardinality) {
+        double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+        int k = static_cast<int>(1.0 / u) - 1;
+        return k < cardinality ? k : rand() % cardinality;
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running FrequencyFixedQueue Unit Tests ===" << std::endl;
+
+        test_exact_when_under_capacity();
+        test_error_bounds_on_skewed_stream();
+        test_weighted_push();
+        test_merge();
+        test_sharded_concurrent_push();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_exact_when_under_capacity() {
+        std::cout << "\n--- Testing Exact Counts Under Capacity ---" << std::endl;
+
+        FrequencyFixedQueue<std::string> queue(10);
+        const char* words[] = {"a", "b", "a", "c", "a", "b"};
+        for (const char* word : words) {
+            queue.Push(word);
+        }
+        std::vector<FrequencyItem<std::string>> items;
+        queue.PopAll(items);
+        assert_true(items.size() == 3, "Should track 3 keys");
+        assert_true(items[0].key == "a" && items[0].count == 3 && items[0].error == 0, "a should be exact");
+        assert_true(items[1].key == "b" && items[1].count == 2, "b should be second");
+        assert_true(queue.Total() == 0, "PopAll should reset the counters");
+    }
+
+    void test_error_bounds_on_skewed_stream() {
+        std::cout << "\n--- Testing Error Bounds On Skewed Stream ---" << std::endl;
+
+        const int kCap = 50;
+        const int kItems = 200000;
+        SpaceSaving<int> summary(kCap);
+        std::map<int, uint64_t> exact;
+        srand(7);
+        for (int i = 0; i < kItems; i++) {
+            int key = skewed_key(100000);
+            summary.Push(key);
+            exact[key]++;
+        }
+        assert_true(summary.Size() == kCap, "Memory should stay at cap counters");
+        assert_true(summary.Total() == static_cast<uint64_t>(kItems), "Total should count every push");
+
+        std::vector<FrequencyItem<int>> items;
+        summary.GetItems(items);
+        bool bounded = true;
+        for (const auto& item : items) {
+            uint64_t truth = exact[item.key];
+            bounded = bounded && item.count >= truth && item.count - item.error <= truth;
+        }
+        assert_true(bounded, "True count should lie within [count - error, count]");
+
+        bool heavy_found = true;
+        for (const auto& kv : exact) {
+            if (kv.second > static_cast<uint64_t>(kItems / kCap)) {
+                bool found = false;
+                for (const auto& item : items) {
+                    found = found || item.key == kv.first;
+                }
+                heavy_found = heavy_found && found;
+            }
+        }
+        assert_true(heavy_found, "Every key above total/cap should be tracked");
+        assert_true(items[0].key == 0 && items[1].key == 1, "Most frequent keys should rank first");
+    }
+
+    void test_weighted_push() {
+        std::cout << "\n--- Testing Weighted Push ---" << std::endl;
+
+        SpaceSaving<int> summary(2);
+        summary.Push(1, 10);
+        summary.Push(2, 5);
+        summary.Push(3, 1);
+        std::vector<FrequencyItem<int>> items;
+        summary.GetItems(items);
+        assert_true(items.size() == 2 && items[0].key == 1 && items[0].count == 10, "Heavy key should survive");
+        assert_true(items[1].key == 3 && items[1].count == 6 && items[1].error == 5, "New key should inherit the minimum as error");
+    }
+
+    void test_merge() {
+        std::cout << "\n--- Testing Merge ---" << std::endl;
+
+        SpaceSaving<int> a(3);
+        SpaceSaving<int> b(3);
+        a.Push(1, 5);
+        a.Push(2, 3);
+        b.Push(1, 4);
+        b.Push(3, 2);
+        a.Merge(b);
+        std::vector<FrequencyItem<int>> items;
+        a.GetItems(items);
+        assert_true(items.size() == 3 && items[0].key == 1 && items[0].count == 9 && items[0].error == 0,
+                    "Common keys should add up exactly when neither side overflowed");
+        assert_true(a.Total() == 14, "Merged total should add up");
+    }
+
+    void test_sharded_concurrent_push() {
+        std::cout << "\n--- Testing Sharded Concurrent Push ---" << std::endl;
+
+        const int kThreads = 4;
+        const int kPerThread = 50000;
+        FrequencyFixedQueue<int> queue(64, kThreads);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; t++) {
+            threads.emplace_back([&queue, t]() {
+                for (int i = 0; i < kPerThread; i++) {
+                    // key 0 is 1/4 of the stream, the rest is spread wide
+                    queue.Push(i % 4 == 0 ? 0 : 1 + (i * 7919 + t) % 10000);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        assert_true(queue.Total() == static_cast<uint64_t>(kThreads) * kPerThread, "Total should count every push");
+        std::vector<FrequencyItem<int>> items;
+        queue.GetItems(items, 5);
+        uint64_t truth = kThreads * kPerThread / 4;
+        assert_true(items.size() == 5, "maxCount should limit the results");
+        assert_true(items[0].key == 0 && items[0].count >= truth && items[0].count - items[0].error <= truth,
+                    "Merged shards should find the heavy hitter within bounds");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestFrequencyFixedQueue test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
@@ -6,6 +6,9 @@
 #include <chrono>
 #include <cassert>
 #include <atomic>
+#include <future>
+#include <fstream>
+#include <string>
 
 // Test data structure
 struct TestData {
@@ -52,6 +55,16 @@ public:
         test_set_capacity();
         test_concurrent_operations();
         test_edge_cases();
+        test_max_age_eviction();
+        test_set_max_age();
+        test_for_each_in_place();
+        test_get_items_append();
+        test_get_item_ptrs();
+        test_push_status();
+        test_stop_returns_when_drained();
+        test_stop_async();
+        test_decimate_sampling();
+        test_reservoir_sampling();
         
         print_summary();
     }
@@ -372,6 +385,343 @@ private:
         assert_true(duration.count() < 200, "Should return quickly when stopped");
     }
     
+    void test_max_age_eviction() {
+        std::cout << "\n--- Testing Max Age Eviction ---" << std::endl;
+        
+        LatestFixedQueue<TestData> queue(5, 100);
+        assert_true(queue.MaxAge() == 100, "Max age should be 100ms");
+        
+        queue.Push(std::make_shared<TestData>(1, "old1"));
+        queue.Push(std::make_shared<TestData>(2, "old2"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        queue.Push(std::make_shared<TestData>(3, "fresh"));
+        assert_true(queue.Size() == 1, "Expired entries should be reclaimed on push");
+        
+        std::vector<TestData> result;
+        queue.GetItems(result);
+        assert_true(result.size() == 1 && result[0].id == 3, "GetItems should only return fresh entries");
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        queue.GetItems(result);
+        assert_true(result.empty(), "GetItems should skip entries that expired since");
+        assert_true(queue.IsEmpty(), "Expired entries should be reclaimed on GetItems");
+    }
+    
+    void test_set_max_age() {
+        std::cout << "\n--- Testing SetMaxAge ---" << std::endl;
+        
+        LatestFixedQueue<TestData> queue(5);
+        queue.Push(std::make_shared<TestData>(1, "test1"));
+        queue.SetMaxAge(100);
+        queue.Push(std::make_shared<TestData>(2, "test2"));
+        
+        std::shared_ptr<TestData> popped;
+        assert_true(queue.Pop(popped) && popped->id == 1, "Entries pushed before SetMaxAge should be kept");
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        queue.SetMaxAge(0);
+        queue.Push(std::make_shared<TestData>(3, "test3"));
+        assert_true(queue.Size() == 2, "Disabled max age should not evict by age");
+    }
+    
+    void test_for_each_in_place() {
+        std::cout << "\n--- Testing ForEach In Place ---" << std::endl;
+        
+        LatestFixedQueue<TestData> queue(5);
+        auto data1 = std::make_shared<TestData>(1, "test1");
+        queue.Push(data1);
+        queue.Push(std::make_shared<TestData>(2, "test2"));
+        queue.Push(std::make_shared<TestData>(3, "test3"));
+        
+        const TestData* first = nullptr;
+        int sum = 0;
+        int visited = queue.ForEach([&](const TestData& data) {
+            if (!first) {
+                first = &data;
+            }
+            sum += data.id;
+            return true;
+        });
+        assert_true(visited == 3 && sum == 6, "ForEach should visit every entry");
+        assert_true(first == data1.get(), "ForEach should visit payloads without copying");
+        
+        visited = queue.ForEach([](const TestData& data) {
+            return data.id < 2;
+        });
+        assert_true(visited == 2, "ForEach should stop when the visitor returns false");
+    }
+    
+    void test_get_items_append() {
+        std::cout << "\n--- Testing GetItems Append ---" << std::endl;
+        
+        LatestFixedQueue<TestData> queue(5);
+        for (int i = 1; i <= 3; i++) {
+            queue.Push(std::make_shared<TestData>(i, "test" + std::to_string(i)));
+        }
+        
+        std::vector<TestData> result;
+        result.reserve(16);
+        const TestData* buffer = result.data();
+        queue.GetItems(result, [](const std::shared_ptr<TestData>& data) {
+            return data->id != 2;
+        });
+        queue.GetItems(result, [](const std::shared_ptr<TestData>& data) {
+            return data->id == 2;
+        }, 0, true);
+        assert_true(result.size() == 3, "Append should keep previous results");
+        assert_true(result[2].id == 2, "Appended item should come last");
+        assert_true(result.data() == buffer, "Reused buffer should not reallocate");
+    }
+    
+    void test_get_item_ptrs() {
+        std::cout << "\n--- Testing GetItemPtrs ---" << std::endl;
+        
+        LatestFixedQueue<TestData> queue(5);
+        auto data1 = std::make_shared<TestData>(1, "test1");
+        queue.Push(data1);
+        queue.Push(std::make_shared<TestData>(2, "test2"));
+        
+        std::vector<std::shared_ptr<TestData>> ptrs;
+        queue.GetItemPtrs(ptrs, [](const std::shared_ptr<TestData>& data) {
+            return true;
+        }, 1);
+        assert_true(ptrs.size() == 1 && ptrs[0] == data1, "GetItemPtrs should share the payload");
+    }
+    
+    void test_push_status() {
+        std::cout << "\n--- Testing Push Status ---" << std::endl;
+        
+        typedef LatestFixedQueue<TestData>::PushStatus PushStatus;
+        LatestFixedQueue<TestData> queue(3);
+        auto data = std::make_shared<TestData>(1, "test");
+        assert_true(queue.Push(data) == PushStatus::kOk, "Push should return kOk while running");
+        
+        std::thread stopper([&]() { queue.Stop(true, 1000); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert_true(queue.Push(data) == PushStatus::kStopping, "Push should return kStopping while draining");
+        
+        std::shared_ptr<TestData> popped;
+        queue.Pop(popped);
+        stopper.join();
+        assert_true(queue.Push(data) == PushStatus::kStopped, "Push should return kStopped after stop");
+    }
+    
+    void test_stop_returns_when_drained() {
+        std::cout << "\n--- Testing Stop Returns When Drained ---" << std::endl;
+        
+        LatestFixedQueue<TestData> queue(3);
+        queue.Push(std::make_shared<TestData>(1, "test1"));
+        queue.Push(std::make_shared<TestData>(2, "test2"));
+        
+        std::thread consumer([&]() {
+            std::shared_ptr<TestData> popped;
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            queue.Pop(popped);
+            queue.Pop(popped);
+        });
+        
+        auto start = std::chrono::steady_clock::now();
+        bool drained = queue.Stop(true, 2000);
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        consumer.join();
+        
+        assert_true(drained, "Stop should report a drained queue");
+        assert_true(duration.count() < 100, "Stop should return as soon as the queue is empty");
+        
+        LatestFixedQueue<TestData> stuck(3);
+        stuck.Push(std::make_shared<TestData>(1, "test1"));
+        assert_true(!stuck.Stop(true, 50), "Stop should report a timeout");
+    }
+    
+    void test_stop_async() {
+        std::cout << "\n--- Testing StopAsync ---" << std::endl;
+        
+        const int kQueues = 200;
+        std::vector<std::unique_ptr<LatestFixedQueue<TestData>>> queues;
+        std::vector<std::future<bool>> stops;
+        for (int i = 0; i < kQueues; i++) {
+            queues.emplace_back(new LatestFixedQueue<TestData>(3));
+            queues.back()->Push(std::make_shared<TestData>(i, "test"));
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        int threads_before = thread_count();
+        for (auto& queue : queues) {
+            stops.push_back(queue->StopAsync(true, 300));
+        }
+        assert_true(thread_count() <= threads_before + 1, "StopAsync should not start a thread per queue");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        for (int i = 0; i < kQueues; i += 2) {
+            std::shared_ptr<TestData> popped;
+            queues[i]->Pop(popped);
+        }
+        
+        int drained = 0;
+        for (auto& stop : stops) {
+            drained += stop.get() ? 1 : 0;
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        
+        assert_true(drained == kQueues / 2, "Half of the queues should drain");
+        assert_true(duration.count() < 500, "Queues should be stopped in parallel");
+        
+        LatestFixedQueue<TestData> aging(3, 50);
+        aging.Push(std::make_shared<TestData>(1, "test"));
+        auto stop = aging.StopAsync(true, 1000);
+        assert_true(stop.wait_for(std::chrono::milliseconds(500)) == std::future_status::ready && stop.get(),
+                    "StopAsync should complete when the last entry ages out");
+        
+        LatestFixedQueue<TestData> idle(3);
+        assert_true(idle.StopAsync(true).get(), "StopAsync on an empty queue should complete at once");
+        std::future<bool> pending;
+        {
+            LatestFixedQueue<TestData> dropped(3);
+            dropped.Push(std::make_shared<TestData>(1, "test"));
+            pending = dropped.StopAsync(true, 50);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        bool broken = false;
+        try {
+            pending.get();
+        } catch (const std::future_error&) {
+            broken = true;
+        }
+        assert_true(broken, "Destroying a queue should cancel its StopAsync deadline");
+        
+        // later StopAsync calls reschedule the timer while the previous one
+        // may be firing; none of them may outlive the queue
+        int completed = 0;
+        for (int i = 0; i < 100; i++) {
+            std::vector<std::future<bool>> racing;
+            {
+                LatestFixedQueue<TestData> racy(3, 2);
+                racy.Push(std::make_shared<TestData>(i, "test"));
+                auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(i % 5);
+                do {
+                    racing.push_back(racy.StopAsync(true, 1 + i % 3));
+                } while (std::chrono::steady_clock::now() < until);
+            }
+            for (auto& stop : racing) {
+                try {
+                    stop.get();
+                    completed++;
+                } catch (const std::future_error&) {
+                }
+            }
+        }
+        assert_true(completed > 0, "Racing StopAsync calls should complete or break, never touch a freed queue");
+    }
+    
+    // Threads of this process, from /proc/self/status.
+    static int thread_count() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 8, "Threads:") == 0) {
+                return std::stoi(line.substr(8));
+            }
+        }
+        return -1;
+    }
+    
+    // Pushes increasing ids for duration_ms, well above any rate threshold
+    // used below. Returns the id of the first push that was sampled out.
+    int push_burst(LatestFixedQueue<int>& queue, int duration_ms, int& next_id, int& kept, int& total) {
+        int first_sampled = -1;
+        auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration_ms);
+        while (std::chrono::steady_clock::now() < end) {
+            for (int i = 0; i < 100; i++) {
+                int id = next_id++;
+                auto status = queue.Push(std::make_shared<int>(id));
+                total++;
+                if (status == LatestFixedQueue<int>::PushStatus::kOk) {
+                    kept++;
+                } else if (first_sampled < 0) {
+                    first_sampled = id;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return first_sampled;
+    }
+    
+    void test_decimate_sampling() {
+        std::cout << "\n--- Testing Decimate Sampling ---" << std::endl;
+        
+        typedef LatestFixedQueue<int>::SamplingMode SamplingMode;
+        LatestFixedQueue<int> queue(100);
+        queue.SetSampling(SamplingMode::kDecimate, 1000, 10);
+        assert_true(!queue.IsSampling() && queue.SamplingRatio() == 1.0, "Should not sample before overload");
+        
+        int next_id = 0;
+        int kept = 0;
+        int total = 0;
+        int first_sampled = push_burst(queue, 300, next_id, kept, total);
+        assert_true(first_sampled > 0 && queue.IsSampling(), "Overload should switch to sampling");
+        double ratio = queue.SamplingRatio();
+        assert_true(ratio > 0.09 && ratio < 0.11, "Decimation should keep every 10th push");
+        
+        std::vector<int> items;
+        queue.GetItems(items);
+        bool stride = items.size() == 100;
+        for (size_t i = 1; i < items.size(); i++) {
+            stride = stride && items[i] - items[i - 1] == 10;
+        }
+        assert_true(stride, "Kept pushes should be evenly spaced");
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        assert_true(!queue.IsSampling() && queue.SamplingRatio() == 1.0,
+                    "Sampling should stop once producers go quiet, without another push");
+        auto status = queue.Push(std::make_shared<int>(next_id++));
+        assert_true(status == LatestFixedQueue<int>::PushStatus::kOk, "Push should be kept after the overload");
+    }
+    
+    void test_reservoir_sampling() {
+        std::cout << "\n--- Testing Reservoir Sampling ---" << std::endl;
+        
+        typedef LatestFixedQueue<int>::SamplingMode SamplingMode;
+        LatestFixedQueue<int> queue(200);
+        queue.SetSampling(SamplingMode::kReservoir, 1000);
+        
+        int next_id = 0;
+        int kept = 0;
+        int total = 0;
+        int first_sampled = push_burst(queue, 300, next_id, kept, total);
+        assert_true(first_sampled > 0 && queue.IsSampling(), "Overload should switch to sampling");
+        
+        std::vector<int> items;
+        queue.GetItems(items);
+        bool sorted = items.size() == 100 && queue.Size() == 100;
+        int early = 0;
+        int middle = first_sampled + (next_id - first_sampled) / 2;
+        for (size_t i = 0; i < items.size(); i++) {
+            sorted = sorted && (i == 0 || items[i] > items[i - 1]);
+            early += items[i] < middle ? 1 : 0;
+        }
+        assert_true(sorted, "Sample should hold half the capacity in push order");
+        assert_true(early > 30 && early < 70, "Sample should cover the whole overload, not the last burst");
+        
+        double ratio = queue.SamplingRatio();
+        assert_true(ratio > 0.0 && ratio < 0.1, "Most pushes should be rejected without being stored");
+        assert_true(kept < total, "Rejected pushes should return kSampledOut");
+        
+        push_burst(queue, 300, next_id, kept, total);
+        double per_entry = static_cast<double>(next_id - first_sampled) / queue.Size();
+        double weight = 1.0 / queue.SamplingRatio();
+        assert_true(weight > 0.9 * per_entry && weight < 1.1 * per_entry,
+                    "Each held entry should stand for 1 / SamplingRatio() pushes");
+        
+        std::shared_ptr<int> popped;
+        for (int i = 0; i < 100; i++) {
+            queue.Pop(popped);
+        }
+        auto status = queue.Push(std::make_shared<int>(next_id++));
+        assert_true(status == LatestFixedQueue<int>::PushStatus::kOk && queue.SamplingRatio() == 1.0,
+                    "Sample should restart once consumers empty the queue");
+    }
+    
     void print_summary() {
         std::cout << "\n=== Test Summary ===" << std::endl;
         std::cout << "Total tests: " << test_count << std::endl;
@@ -0,0 +1,140 @@
+#include "NumaAllocator.h"
+#include "RingQueue.h"
+#include "LatestFixedQueue.h"
+#include "BroadcastQueue.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class TestNumaAllocator {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running NumaAllocator Unit Tests ===" << std::endl;
+
+        test_small_allocation();
+        test_huge_page_alignment();
+        test_rebind_keeps_policy();
+        test_ring_queue_storage();
+        test_latest_fixed_queue_storage();
+        test_broadcast_queue_storage();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_small_allocation() {
+        std::cout << "\n--- Testing Small Allocation ---" << std::endl;
+
+        NumaAllocator<int> alloc(NumaAllocator<int>::CurrentNode());
+        std::vector<int, NumaAllocator<int>> v(1000, 7, alloc);
+        assert_true(v.size() == 1000 && v[0] == 7 && v[999] == 7, "Vector should be usable");
+        v.resize(5000, 3);
+        assert_true(v[4999] == 3 && v[0] == 7, "Vector should survive reallocation");
+    }
+
+    void test_huge_page_alignment() {
+        std::cout << "\n--- Testing Huge Page Alignment ---" << std::endl;
+
+        NumaAllocator<uint64_t> alloc(0, true);
+        size_t n = 3 * NumaAllocator<uint64_t>::kHugePageBytes / sizeof(uint64_t);
+        uint64_t* p = alloc.allocate(n);
+        assert_true(reinterpret_cast<size_t>(p) % NumaAllocator<uint64_t>::kHugePageBytes == 0,
+                    "Large allocation should be 2MB aligned");
+        bool zeroed = true;
+        for (size_t i = 0; i < n; i += 4096) {
+            zeroed = zeroed && p[i] == 0;
+            p[i] = i;
+        }
+        assert_true(zeroed, "Prefaulted memory should be zeroed");
+        alloc.deallocate(p, n);
+
+        NumaAllocator<uint64_t> no_huge(NumaAllocator<uint64_t>::kAnyNode, false, 0);
+        p = no_huge.allocate(n);
+        p[n - 1] = 1;
+        assert_true(p[n - 1] == 1, "Allocation without huge pages should be usable");
+        no_huge.deallocate(p, n);
+    }
+
+    void test_rebind_keeps_policy() {
+        std::cout << "\n--- Testing Rebind Keeps Policy ---" << std::endl;
+
+        NumaAllocator<int> alloc(1, false, 4096);
+        NumaAllocator<double> rebound(alloc);
+        assert_true(rebound.Node() == 1 && !rebound.Prefault() && rebound.HugePageBytes() == 4096,
+                    "Rebound allocator should keep node and policy");
+        assert_true(alloc == rebound, "Allocators with the same policy should compare equal");
+        assert_true(alloc != NumaAllocator<int>(0), "Allocators on different nodes should differ");
+    }
+
+    void test_ring_queue_storage() {
+        std::cout << "\n--- Testing RingQueue Storage ---" << std::endl;
+
+        NumaAllocator<long> alloc(NumaAllocator<long>::CurrentNode());
+        RingQueue<long, NumaAllocator<long>> queue(1 << 20, alloc);
+        auto tracer = std::make_shared<QueueTracer>("numa");
+        queue.SetTracer(tracer);
+        bool ok = true;
+        for (long i = 0; i < 100; i++) {
+            ok = ok && queue.Push(i);
+        }
+        long data = 0;
+        for (long i = 0; i < 100; i++) {
+            ok = ok && queue.Pop(data) && data == i;
+        }
+        assert_true(ok, "RingQueue should work on NUMA storage");
+        assert_true(tracer->Histogram().Count() == 100, "Trace stamps should live on NUMA storage too");
+    }
+
+    void test_latest_fixed_queue_storage() {
+        std::cout << "\n--- Testing LatestFixedQueue Storage ---" << std::endl;
+
+        LatestFixedQueue<std::string, NumaAllocator<std::string>> queue(
+            4, 0, NumaAllocator<std::string>(NumaAllocator<std::string>::CurrentNode()));
+        for (int i = 0; i < 6; i++) {
+            queue.Push(std::make_shared<std::string>(std::to_string(i)));
+        }
+        std::vector<std::string> result;
+        queue.GetItems(result);
+        assert_true(result.size() == 4 && result[0] == "2" && result[3] == "5",
+                    "LatestFixedQueue should work on NUMA storage");
+    }
+
+    void test_broadcast_queue_storage() {
+        std::cout << "\n--- Testing BroadcastQueue Storage ---" << std::endl;
+
+        BroadcastQueue<int, NumaAllocator<int>> queue(8, NumaAllocator<int>(0));
+        auto* reader = queue.AddReader();
+        queue.Push(5);
+        int data = 0;
+        assert_true(reader->Pop(data) && data == 5, "BroadcastQueue should work on NUMA storage");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestNumaAllocator test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
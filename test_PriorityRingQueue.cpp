@@ -0,0 +1,165 @@
+#include "PriorityRingQueue.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+class TestPriorityRingQueue {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running PriorityRingQueue Unit Tests ===" << std::endl;
+
+        test_priority_order();
+        test_fifo_within_level();
+        test_level_capacity();
+        test_invalid_level();
+        test_pop_all();
+        test_pop_timeout();
+        test_blocking_pop_and_push();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_priority_order() {
+        std::cout << "\n--- Testing Priority Order ---" << std::endl;
+
+        PriorityRingQueue<std::string> queue(4, 3);
+        queue.Push("low", 3);
+        queue.Push("high", 0);
+        queue.Push("mid", 1);
+
+        std::string data;
+        int level = -1;
+        assert_true(queue.Pop(data, 0, &level) && data == "high" && level == 0, "Should pop level 0 first");
+        assert_true(queue.Pop(data) && data == "mid", "Should pop level 1 second");
+        assert_true(queue.Pop(data) && data == "low", "Should pop level 3 last");
+        assert_true(queue.IsEmpty(), "Queue should be empty");
+    }
+
+    void test_fifo_within_level() {
+        std::cout << "\n--- Testing FIFO Within Level ---" << std::endl;
+
+        PriorityRingQueue<int> queue(2, 4);
+        for (int i = 0; i < 4; i++) {
+            queue.Push(i, 1);
+        }
+        bool ordered = true;
+        int data = -1;
+        for (int i = 0; i < 4; i++) {
+            ordered = ordered && queue.Pop(data) && data == i;
+        }
+        assert_true(ordered, "Items of one level should pop in FIFO order");
+    }
+
+    void test_level_capacity() {
+        std::cout << "\n--- Testing Level Capacity ---" << std::endl;
+
+        PriorityRingQueue<int> queue(2, 2);
+        assert_true(queue.Push(1, 0) && queue.Push(2, 0), "Should fill level 0");
+        assert_true(queue.IsFull(0), "Level 0 should be full");
+        assert_true(!queue.Push(3, 0), "Push to a full level should fail");
+        assert_true(queue.Push(3, 1), "Other levels should still accept items");
+        assert_true(queue.Size() == 3, "Size should count all levels");
+    }
+
+    void test_invalid_level() {
+        std::cout << "\n--- Testing Invalid Level ---" << std::endl;
+
+        PriorityRingQueue<int> queue(2, 2);
+        assert_true(!queue.Push(1, -1), "Negative level should be rejected");
+        assert_true(!queue.Push(1, 2), "Level beyond range should be rejected");
+
+        PriorityRingQueue<int> wide(100, 1);
+        assert_true(wide.Levels() == PriorityRingQueue<int>::kMaxLevels, "Levels should be clamped");
+        assert_true(wide.Push(7, 63), "Highest level should work");
+        int data = 0;
+        assert_true(wide.Pop(data) && data == 7, "Pop from level 63 should work");
+    }
+
+    void test_pop_all() {
+        std::cout << "\n--- Testing PopAll ---" << std::endl;
+
+        PriorityRingQueue<int> queue(3, 4);
+        queue.Push(20, 2);
+        queue.Push(0, 0);
+        queue.Push(21, 2);
+        queue.Push(10, 1);
+
+        std::vector<int> data_arr;
+        queue.PopAll(data_arr);
+        assert_true(data_arr.size() == 4, "PopAll should return 4 items");
+        assert_true(data_arr[0] == 0 && data_arr[1] == 10 && data_arr[2] == 20 && data_arr[3] == 21,
+                    "PopAll should return items by priority, FIFO within level");
+        assert_true(queue.IsEmpty(), "Queue should be empty after PopAll");
+    }
+
+    void test_pop_timeout() {
+        std::cout << "\n--- Testing Pop Timeout ---" << std::endl;
+
+        PriorityRingQueue<int> queue(2, 2);
+        int data = 0;
+        assert_true(!queue.Pop(data), "Non-blocking pop on empty queue should fail");
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = queue.Pop(data, 100);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        assert_true(!ok, "Timed pop on empty queue should fail");
+        assert_true(elapsed.count() >= 90 && elapsed.count() < 500, "Timed pop should wait about 100ms");
+    }
+
+    void test_blocking_pop_and_push() {
+        std::cout << "\n--- Testing Blocking Pop and Push ---" << std::endl;
+
+        PriorityRingQueue<int> queue(2, 1);
+        int popped = -1;
+        std::thread consumer([&]() {
+            queue.Pop(popped, -1);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue.Push(42, 1);
+        consumer.join();
+        assert_true(popped == 42, "Blocking pop should receive pushed item");
+
+        queue.Push(1, 0);
+        bool pushed = false;
+        std::thread producer([&]() {
+            pushed = queue.Push(2, 0, true);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        int data = 0;
+        queue.Pop(data);
+        producer.join();
+        assert_true(pushed, "Blocking push should succeed once the level has room");
+        assert_true(queue.Pop(data) && data == 2, "Blocked item should be queued");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestPriorityRingQueue test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
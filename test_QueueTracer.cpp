@@ -0,0 +1,185 @@
+#include "QueueTracer.h"
+#include "RingQueue.h"
+#include "LatestFixedQueue.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+class TestQueueTracer {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running QueueTracer Unit Tests ===" << std::endl;
+
+        test_histogram_percentiles();
+        test_histogram_large_values();
+        test_ring_queue_sojourn();
+        test_sampling();
+        test_tsc_clock();
+        test_latest_fixed_queue_sojourn();
+        test_chrome_trace_export();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_histogram_percentiles() {
+        std::cout << "\n--- Testing Histogram Percentiles ---" << std::endl;
+
+        LatencyHistogram histogram;
+        for (uint64_t v = 1; v <= 10000; v++) {
+            histogram.Record(v);
+        }
+        assert_true(histogram.Count() == 10000, "Histogram should count every value");
+        assert_true(histogram.Max() == 10000, "Histogram should track max");
+        assert_true(histogram.Mean() > 5000 && histogram.Mean() < 5001, "Histogram mean should be exact");
+
+        uint64_t p50 = histogram.Percentile(50);
+        uint64_t p99 = histogram.Percentile(99);
+        assert_true(p50 >= 5000 && p50 <= 5000 * 1.04, "p50 should be within bucket error");
+        assert_true(p99 >= 9900 && p99 <= 9900 * 1.04, "p99 should be within bucket error");
+        assert_true(histogram.Percentile(100) == 10000, "p100 should be the max");
+
+        histogram.Reset();
+        assert_true(histogram.Count() == 0 && histogram.Percentile(50) == 0, "Reset should clear the histogram");
+    }
+
+    void test_histogram_large_values() {
+        std::cout << "\n--- Testing Histogram Large Values ---" << std::endl;
+
+        LatencyHistogram histogram;
+        histogram.Record(~uint64_t(0));
+        histogram.Record(uint64_t(1) << 40);
+        assert_true(histogram.Count() == 2, "Large values should be recorded");
+        uint64_t p50 = histogram.Percentile(50);
+        assert_true(p50 >= (uint64_t(1) << 40) && p50 < (uint64_t(1) << 40) + (uint64_t(1) << 36),
+                    "Large values should keep relative precision");
+    }
+
+    void test_ring_queue_sojourn() {
+        std::cout << "\n--- Testing RingQueue Sojourn ---" << std::endl;
+
+        auto tracer = std::make_shared<QueueTracer>("ring");
+        RingQueue<int> queue(4);
+        queue.SetTracer(tracer);
+
+        queue.Push(1);
+        queue.Push(2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        int data = 0;
+        queue.Pop(data);
+        std::vector<int> data_arr;
+        queue.PopAll(data_arr);
+
+        const LatencyHistogram& histogram = tracer->Histogram();
+        assert_true(histogram.Count() == 2, "Pop and PopAll should both record");
+        assert_true(histogram.Percentile(50) >= 19000000 && histogram.Max() < 500000000,
+                    "Sojourn should be about 20ms");
+
+        queue.SetTracer(nullptr);
+        queue.Push(3);
+        queue.Pop(data);
+        assert_true(histogram.Count() == 2, "Disabled tracing should record nothing");
+    }
+
+    void test_sampling() {
+        std::cout << "\n--- Testing Sampling ---" << std::endl;
+
+        auto tracer = std::make_shared<QueueTracer>("sampled", 4);
+        RingQueue<int> queue(16);
+        queue.SetTracer(tracer);
+        for (int i = 0; i < 16; i++) {
+            queue.Push(i);
+        }
+        std::vector<int> data_arr;
+        queue.PopAll(data_arr);
+        assert_true(tracer->Histogram().Count() == 4, "Every 4th pop should be recorded");
+    }
+
+    void test_tsc_clock() {
+        std::cout << "\n--- Testing TSC Clock ---" << std::endl;
+
+        QueueTracer tracer("tsc", 1, 0, QueueTracer::kTsc);
+        uint64_t stamp = tracer.Now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        tracer.RecordSojourn(stamp);
+        uint64_t sojourn = tracer.Histogram().Max();
+        assert_true(sojourn >= 9000000 && sojourn < 200000000, "Calibrated TSC should measure about 10ms");
+    }
+
+    void test_latest_fixed_queue_sojourn() {
+        std::cout << "\n--- Testing LatestFixedQueue Sojourn ---" << std::endl;
+
+        auto tracer = std::make_shared<QueueTracer>("latest", 1, 16);
+        LatestFixedQueue<int> queue(2);
+        queue.SetTracer(tracer);
+        for (int i = 0; i < 3; i++) {
+            queue.Push(std::make_shared<int>(i));
+        }
+        std::shared_ptr<int> data;
+        queue.Pop(data);
+        queue.Pop(data);
+        assert_true(tracer->Histogram().Count() == 2, "Only popped entries should be recorded");
+    }
+
+    void test_chrome_trace_export() {
+        std::cout << "\n--- Testing Chrome Trace Export ---" << std::endl;
+
+        auto stage1 = std::make_shared<QueueTracer>("stage \"1\"", 1, 2);
+        auto stage2 = std::make_shared<QueueTracer>("stage2", 1, 8);
+        RingQueue<int> q1(8);
+        RingQueue<int> q2(8);
+        q1.SetTracer(stage1);
+        q2.SetTracer(stage2);
+        for (int i = 0; i < 5; i++) {
+            q1.Push(i);
+            int data = 0;
+            q1.Pop(data);
+            q2.Push(data);
+            q2.Pop(data);
+        }
+
+        std::ostringstream os;
+        QueueTracer::WriteChromeTrace(os, {stage1.get(), stage2.get()});
+        std::string json = os.str();
+
+        size_t spans = 0;
+        for (size_t pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos + 1)) {
+            spans++;
+        }
+        assert_true(json.find("{\"traceEvents\":[") == 0, "Trace should start with traceEvents");
+        assert_true(spans == 2 + 5, "Trace should keep the latest events per queue");
+        assert_true(json.find("stage \\\"1\\\"") != std::string::npos, "Queue names should be escaped");
+        assert_true(json.find("\"tid\":1") != std::string::npos, "Each queue should get its own track");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestQueueTracer test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+#include "RingQueue.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+
+struct Tick {
+    long seq;
+    double price;
+};
+
+class TestRingQueueSpill {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running RingQueue Spill Unit Tests ===" << std::endl;
+
+        test_push_without_spill_fails_when_full();
+        test_spill_keeps_fifo_order();
+        test_spill_interleaved();
+        test_spill_pop_all();
+        test_spill_reset();
+        test_spill_concurrent();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_push_without_spill_fails_when_full() {
+        std::cout << "\n--- Testing Push Without Spill ---" << std::endl;
+
+        RingQueue<Tick> queue(2);
+        Tick tick = {0, 1.0};
+        assert_true(queue.Push(tick) && queue.Push(tick), "Should fill the ring");
+        assert_true(!queue.Push(tick), "Push should fail when full without spill");
+        assert_true(queue.SpilledSize() == 0, "Nothing should be spilled");
+    }
+
+    void test_spill_keeps_fifo_order() {
+        std::cout << "\n--- Testing Spill Keeps FIFO Order ---" << std::endl;
+
+        RingQueue<Tick> queue(4);
+        assert_true(queue.EnableSpill("/tmp", 16 * sizeof(Tick)), "EnableSpill should succeed");
+        assert_true(!queue.EnableSpill("/tmp"), "EnableSpill twice should fail");
+
+        bool pushed = true;
+        for (long i = 0; i < 100; i++) {
+            Tick tick = {i, i * 0.5};
+            pushed = pushed && queue.Push(tick);
+        }
+        assert_true(pushed, "Every push should succeed with spill enabled");
+        assert_true(queue.IsFull(), "Ring should be full");
+        assert_true(queue.SpilledSize() == 96, "Overflow should go to the spill file");
+
+        bool ordered = true;
+        Tick tick;
+        for (long i = 0; i < 100; i++) {
+            ordered = ordered && queue.Pop(tick) && tick.seq == i && tick.price == i * 0.5;
+        }
+        assert_true(ordered, "Items should pop in FIFO order across ring and spill");
+        assert_true(queue.IsEmpty() && queue.SpilledSize() == 0, "Queue should be empty");
+        assert_true(!queue.Pop(tick), "Pop on empty queue should fail");
+    }
+
+    void test_spill_interleaved() {
+        std::cout << "\n--- Testing Spill Interleaved Push/Pop ---" << std::endl;
+
+        RingQueue<Tick> queue(3);
+        queue.EnableSpill("/tmp", 4 * sizeof(Tick));
+
+        long next_push = 0;
+        long next_pop = 0;
+        bool ordered = true;
+        for (int round = 0; round < 50; round++) {
+            for (int i = 0; i < round % 7 + 1; i++) {
+                Tick tick = {next_push++, 0};
+                queue.Push(tick);
+            }
+            for (int i = 0; i < round % 5 + 1; i++) {
+                Tick tick;
+                if (queue.Pop(tick)) {
+                    ordered = ordered && tick.seq == next_pop++;
+                }
+            }
+        }
+        Tick tick;
+        while (queue.Pop(tick)) {
+            ordered = ordered && tick.seq == next_pop++;
+        }
+        assert_true(ordered, "Interleaved pushes and pops should stay in FIFO order");
+        assert_true(next_pop == next_push, "Every pushed item should be popped");
+    }
+
+    void test_spill_pop_all() {
+        std::cout << "\n--- Testing Spill PopAll ---" << std::endl;
+
+        RingQueue<Tick> queue(2);
+        queue.EnableSpill("/tmp", 2 * sizeof(Tick));
+        for (long i = 0; i < 7; i++) {
+            Tick tick = {i, 0};
+            queue.Push(tick);
+        }
+        std::vector<Tick> data_arr;
+        queue.PopAll(data_arr);
+        bool ordered = data_arr.size() == 7;
+        for (size_t i = 0; ordered && i < data_arr.size(); i++) {
+            ordered = data_arr[i].seq == static_cast<long>(i);
+        }
+        assert_true(ordered, "PopAll should drain ring and spill in order");
+    }
+
+    void test_spill_reset() {
+        std::cout << "\n--- Testing Spill Reset ---" << std::endl;
+
+        RingQueue<Tick> queue(2);
+        queue.EnableSpill("/tmp", 2 * sizeof(Tick));
+        for (long i = 0; i < 5; i++) {
+            Tick tick = {i, 0};
+            queue.Push(tick);
+        }
+        queue.Reset();
+        assert_true(queue.IsEmpty() && queue.SpilledSize() == 0, "Reset should drop spilled items");
+        Tick tick = {42, 0};
+        queue.Push(tick);
+        assert_true(queue.Pop(tick) && tick.seq == 42, "Queue should work after reset");
+    }
+
+    void test_spill_concurrent() {
+        std::cout << "\n--- Testing Spill Concurrent ---" << std::endl;
+
+        const long kItems = 200000;
+        RingQueue<Tick> queue(64);
+        queue.EnableSpill("/tmp", 1024 * sizeof(Tick));
+
+        bool ordered = true;
+        std::thread consumer([&]() {
+            long expected = 0;
+            Tick tick;
+            while (expected < kItems) {
+                if (queue.Pop(tick, 100)) {
+                    ordered = ordered && tick.seq == expected;
+                    expected++;
+                }
+            }
+        });
+
+        bool pushed = true;
+        for (long i = 0; i < kItems; i++) {
+            Tick tick = {i, 0};
+            pushed = pushed && queue.Push(tick);
+        }
+        consumer.join();
+        assert_true(pushed, "Producer should never fail with spill enabled");
+        assert_true(ordered, "Consumer should see every item in order");
+        assert_true(queue.IsEmpty(), "Queue should be empty");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestRingQueueSpill test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}
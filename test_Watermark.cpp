@@ -0,0 +1,264 @@
+#include "Watermark.h"
+#include "RingQueue.h"
+#include "LatestFixedQueue.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <poll.h>
+
+class TestWatermark {
+private:
+    int test_count = 0;
+    int passed_count = 0;
+
+    void assert_true(bool condition, const std::string& test_name) {
+        test_count++;
+        if (condition) {
+            passed_count++;
+            std::cout << "[PASS] " << test_name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << test_name << std::endl;
+        }
+    }
+
+public:
+    bool run_all_tests() {
+        std::cout << "=== Running Watermark Unit Tests ===" << std::endl;
+
+        test_edge_triggered();
+        test_eventfd();
+        test_stale_size_race();
+        test_ring_queue_watermark();
+        test_ring_queue_watermark_concurrent();
+        test_latest_fixed_queue_watermark();
+        test_credits();
+        test_credits_with_spill();
+        test_credits_concurrent();
+
+        print_summary();
+        return passed_count == test_count;
+    }
+
+private:
+    void test_edge_triggered() {
+        std::cout << "\n--- Testing Edge Triggered Callbacks ---" << std::endl;
+
+        std::vector<bool> events;
+        Watermark watermark(8, 2, [&](bool high) { events.push_back(high); });
+        for (int size = 0; size <= 10; size++) {
+            watermark.Update(size);
+        }
+        assert_true(events.size() == 1 && events[0], "Crossing high should fire once");
+        assert_true(watermark.IsHigh(), "State should be high");
+
+        for (int size = 10; size >= 3; size--) {
+            watermark.Update(size);
+        }
+        assert_true(events.size() == 1, "Nothing should fire between the watermarks");
+        watermark.Update(2);
+        watermark.Update(1);
+        assert_true(events.size() == 2 && !events[1], "Falling to low should fire once");
+        assert_true(!watermark.IsHigh(), "State should be low");
+    }
+
+    void test_eventfd() {
+        std::cout << "\n--- Testing EventFd ---" << std::endl;
+
+        Watermark watermark(2, 0, Watermark::Callback(), true);
+        assert_true(watermark.EventFd() >= 0, "EventFd should be created");
+
+        struct pollfd pfd = {watermark.EventFd(), POLLIN, 0};
+        assert_true(poll(&pfd, 1, 0) == 0, "EventFd should not be readable initially");
+        watermark.Update(2);
+        assert_true(poll(&pfd, 1, 0) == 1, "EventFd should be readable after crossing");
+        uint64_t count = 0;
+        assert_true(read(watermark.EventFd(), &count, sizeof(count)) == sizeof(count) && count == 1,
+                    "EventFd should count one crossing");
+
+        Watermark no_fd(2, 0);
+        assert_true(no_fd.EventFd() == -1, "EventFd should be -1 when not requested");
+    }
+
+    void test_stale_size_race() {
+        std::cout << "\n--- Testing Stale Size Race ---" << std::endl;
+
+        // A producer read size 10, then a consumer drained the queue and
+        // reported 0 while the state was still low, then the producer's
+        // stale 10 fired high.
+        std::vector<bool> events;
+        Watermark watermark(8, 2, [&](bool high) { events.push_back(high); });
+        watermark.Update(0);
+        int reads = 0;
+        watermark.UpdateFrom([&reads] { return reads++ == 0 ? 10 : 0; });
+        assert_true(events.size() == 2 && events[0] && !events[1],
+                    "UpdateFrom should fire low after a stale high");
+        assert_true(!watermark.IsHigh(), "State should match the current size");
+    }
+
+    void test_ring_queue_watermark_concurrent() {
+        std::cout << "\n--- Testing RingQueue Watermark Concurrent ---" << std::endl;
+
+        auto watermark = std::make_shared<Watermark>(2, 0);
+        RingQueue<int> queue(4);
+        queue.SetWatermark(watermark);
+        const int kItems = 200000;
+        std::thread consumer([&]() {
+            int data = 0;
+            for (int i = 0; i < kItems; i++) {
+                queue.Pop(data, -1);
+            }
+        });
+        for (int i = 0; i < kItems; i++) {
+            queue.Push(i, true);
+        }
+        consumer.join();
+        assert_true(queue.IsEmpty() && !watermark->IsHigh(), "Drained queue should not stay flagged high");
+    }
+
+    void test_ring_queue_watermark() {
+        std::cout << "\n--- Testing RingQueue Watermark ---" << std::endl;
+
+        int high_count = 0;
+        int low_count = 0;
+        auto watermark = std::make_shared<Watermark>(3, 1, [&](bool high) {
+            (high ? high_count : low_count)++;
+        });
+        RingQueue<int> queue(4);
+        queue.SetWatermark(watermark);
+
+        for (int i = 0; i < 4; i++) {
+            queue.Push(i);
+        }
+        assert_true(high_count == 1 && watermark->IsHigh(), "Reaching 3 items should fire high once");
+
+        int data = 0;
+        queue.Pop(data);
+        queue.Pop(data);
+        assert_true(low_count == 0, "Two items left should not fire low");
+        queue.Pop(data);
+        assert_true(low_count == 1 && !watermark->IsHigh(), "One item left should fire low");
+
+        queue.Push(9);
+        queue.Push(9);
+        queue.Push(9);
+        std::vector<int> data_arr;
+        queue.PopAll(data_arr);
+        assert_true(high_count == 2 && low_count == 2, "PopAll should report the drained size");
+    }
+
+    void test_latest_fixed_queue_watermark() {
+        std::cout << "\n--- Testing LatestFixedQueue Watermark ---" << std::endl;
+
+        std::vector<bool> events;
+        auto watermark = std::make_shared<Watermark>(2, 0, [&](bool high) { events.push_back(high); });
+        LatestFixedQueue<int> queue(3);
+        queue.SetWatermark(watermark);
+
+        for (int i = 0; i < 5; i++) {
+            queue.Push(std::make_shared<int>(i));
+        }
+        assert_true(events.size() == 1 && events[0], "Evicting pushes should fire high only once");
+
+        queue.Clear();
+        assert_true(events.size() == 2 && !events[1], "Clear should fire low");
+    }
+
+    void test_credits() {
+        std::cout << "\n--- Testing Credits ---" << std::endl;
+
+        RingQueue<int> queue(4);
+        assert_true(queue.AcquireCredits(3) == 3, "Should grant 3 credits");
+        assert_true(queue.Credits() == 3, "Credits should be 3");
+        assert_true(queue.AcquireCredits(3) == 1, "Only one more slot should be free");
+
+        bool pushed = true;
+        for (int i = 0; i < 4; i++) {
+            pushed = pushed && queue.Push(i);
+        }
+        assert_true(pushed && queue.Credits() == 0, "Pushes should use the credits");
+        assert_true(!queue.Push(4), "Push without credits should fail when full");
+
+        int data = 0;
+        queue.Pop(data);
+        queue.Pop(data);
+        assert_true(queue.AcquireCredits(2) == 2, "Popped slots should be grantable");
+        queue.Push(5);
+        queue.ReleaseCredits();
+        assert_true(queue.Credits() == 0, "ReleaseCredits should return unused credits");
+        assert_true(queue.Push(6) && !queue.Push(7), "Released slot should be usable once");
+
+        std::vector<int> data_arr;
+        queue.PopAll(data_arr);
+        assert_true(data_arr.size() == 4 && data_arr[0] == 2 && data_arr[3] == 6, "Items should stay in FIFO order");
+
+        RingQueue<int> small(4);
+        assert_true(small.AcquireCredits(5, true) == 4, "Credits above the capacity should be clamped");
+        assert_true(small.AcquireCredits(1, true) == 0, "No credits should be granted beyond the capacity");
+        small.ReleaseCredits();
+    }
+
+    void test_credits_with_spill() {
+        std::cout << "\n--- Testing Credits With Spill ---" << std::endl;
+
+        RingQueue<int> queue(2);
+        queue.EnableSpill("/tmp", 64);
+        for (int i = 0; i < 4; i++) {
+            queue.Push(i);
+        }
+        assert_true(queue.AcquireCredits(1) == 0, "No credits while items are spilled");
+
+        int data = 0;
+        bool ordered = true;
+        for (int i = 0; i < 4; i++) {
+            ordered = ordered && queue.Pop(data) && data == i;
+        }
+        assert_true(queue.AcquireCredits(2) == 2, "Credits should be granted once the spill is drained");
+        queue.Push(4);
+        queue.Push(5);
+        queue.Push(6);
+        for (int i = 4; i < 7; i++) {
+            ordered = ordered && queue.Pop(data) && data == i;
+        }
+        assert_true(ordered, "Credits and spill should keep FIFO order");
+    }
+
+    void test_credits_concurrent() {
+        std::cout << "\n--- Testing Credits Concurrent ---" << std::endl;
+
+        const int kItems = 100000;
+        RingQueue<int> queue(64);
+        bool ordered = true;
+        std::thread consumer([&]() {
+            int data = 0;
+            for (int expected = 0; expected < kItems; ) {
+                if (queue.Pop(data, 100)) {
+                    ordered = ordered && data == expected;
+                    expected++;
+                }
+            }
+        });
+
+        for (int i = 0; i < kItems; ) {
+            int granted = queue.AcquireCredits(16, true);
+            for (int j = 0; j < granted; j++) {
+                queue.Push(i++);
+            }
+        }
+        consumer.join();
+        assert_true(ordered, "Credited pushes should arrive in order");
+    }
+
+    void print_summary() {
+        std::cout << "\n=== Test Summary ===" << std::endl;
+        std::cout << "Total tests: " << test_count << std::endl;
+        std::cout << "Passed: " << passed_count << std::endl;
+        std::cout << "Failed: " << (test_count - passed_count) << std::endl;
+    }
+};
+
+int main() {
+    TestWatermark test_suite;
+    return test_suite.run_all_tests() ? 0 : 1;
+}